@@ -0,0 +1,246 @@
+// This header file contains a pluggable allocator interface, defined here so that every container can
+// include it and get its memory through an allocator chosen by the caller, instead of calling malloc()/free()
+// directly. This lets us route a container's allocations to another allocator (e.g. a jemalloc arena), and
+// measure how much memory each container uses.
+//
+// An allocator is a struct of function ptrs (a vtable). Concrete allocators embed it as their first member,
+// so a ptr to the concrete allocator can be used as an allocator* and cast back inside its functions.
+// Containers only call ds_alloc()/ds_free(), and a NULL allocator* means plain malloc()/free().
+//
+// Three allocators are provided:
+// - default: malloc()/free()
+// - arena (bump allocator): hands out memory from large chunks by bumping a ptr, in allocation order.
+//   Individual frees are no-ops. arena_reset() drops everything at once in O(1) and keeps the chunks for reuse,
+//   and arena_release() gives all chunks back to the system, in O(number of chunks)
+// - tracking: forwards to another allocator and counts live and peak bytes, so we can report the footprint
+//   of one container instance and its bytes per element
+
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "counters.h"
+
+typedef struct allocator allocator;
+
+struct allocator {
+    void* (*alloc)(allocator *a, size_t size);
+    void (*free)(allocator *a, void *p, size_t size); // NULL if memory is only given back all at once (arena)
+};
+
+
+// Allocate size bytes from allocator a (malloc() if a is NULL)
+void* ds_alloc(allocator *a, size_t size) {
+    COUNT(allocations);
+    if (a == NULL) return malloc(size);
+    return a->alloc(a, size);
+}
+
+
+// Give back p, which was allocated with size bytes from allocator a (free() if a is NULL)
+void ds_free(allocator *a, void *p, size_t size) {
+    if (p == NULL) return;
+    COUNT(frees);
+    if (a == NULL) free(p);
+    else if (a->free != NULL) a->free(a, p, size);
+}
+
+
+// Resize p from old_size to new_size bytes, keeping its contents (like realloc())
+void* ds_realloc(allocator *a, void *p, size_t old_size, size_t new_size) {
+    if (a == NULL) return realloc(p, new_size); // counted neither as allocation nor as free, like a resize
+    void *new_p = ds_alloc(a, new_size);
+    if (new_p == NULL) return NULL; // like realloc(), p is left untouched
+    if (p != NULL) memcpy(new_p, p, old_size < new_size ? old_size : new_size);
+    ds_free(a, p, old_size);
+    return new_p;
+}
+
+
+
+// Allocate size bytes aligned to alignment (a power of 2, at least sizeof(void*)), e.g. on a cache line boundary, from
+// allocator a (aligned_alloc() if a is NULL, in which case size must be a multiple of alignment). Allocators only
+// guarantee 8-byte alignment, so we take alignment extra bytes from them and keep the ptr they returned just before
+// the aligned block, for ds_free_aligned()
+void* ds_alloc_aligned(allocator *a, size_t alignment, size_t size) {
+    if (a == NULL) {
+        COUNT(allocations);
+        return aligned_alloc(alignment, size);
+    }
+    char *raw = (char*)ds_alloc(a, size + alignment);
+    if (raw == NULL) return NULL;
+    char *p = (char*)(((uintptr_t)raw + alignment) & ~(uintptr_t)(alignment - 1)); // at least 8 bytes after raw
+    ((void**)p)[-1] = raw;
+    return p;
+}
+
+
+// Give back p, which was allocated with ds_alloc_aligned(a, alignment, size)
+void ds_free_aligned(allocator *a, void *p, size_t alignment, size_t size) {
+    if (p == NULL) return;
+    if (a == NULL) {
+        COUNT(frees);
+        free(p);
+    }
+    else ds_free(a, ((void**)p)[-1], size + alignment);
+}
+
+
+
+// Default allocator: malloc()/free()
+void* malloc_alloc(allocator *a, size_t size) {
+    (void)a;
+    return malloc(size);
+}
+
+void malloc_free(allocator *a, void *p, size_t size) {
+    (void)a;
+    (void)size;
+    free(p);
+}
+
+allocator default_allocator = {malloc_alloc, malloc_free};
+
+
+
+// Arena (bump) allocator
+#define ARENA_DEFAULT_CHUNK_SIZE (1 << 20)
+#define ARENA_ALIGNMENT 8 // enough for ptrs and 64-bit fields, and keeps e.g. 24-byte nodes at 24 bytes (not 32)
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size; // usable bytes in data
+    max_align_t data[];
+} arena_chunk;
+
+typedef struct arena_allocator {
+    allocator base;
+    arena_chunk *chunks;  // all chunks, in the order they are used
+    arena_chunk *current; // chunk that is allocated from
+    char *cur;            // next free byte in the current chunk
+    size_t left;          // free bytes left in the current chunk
+    size_t chunk_size;
+    size_t used_bytes;    // bytes handed out since the last reset
+} arena_allocator;
+
+
+// Allocate from the current chunk. When it is full, move on to the next chunk (kept from before the last reset),
+// or add a new chunk after the current one if there is no next chunk or it is too small
+void* arena_alloc(allocator *a, size_t size) {
+    arena_allocator *arena = (arena_allocator*)a;
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if (size > arena->left) {
+        arena_chunk *next = arena->current != NULL ? arena->current->next : arena->chunks;
+        if (next == NULL || next->size < size) {
+            size_t chunk_bytes = size > arena->chunk_size ? size : arena->chunk_size;
+            arena_chunk *chunk = (arena_chunk*)malloc(sizeof(arena_chunk) + chunk_bytes);
+            if (chunk == NULL) return NULL;
+            chunk->size = chunk_bytes;
+            chunk->next = next;
+            if (arena->current != NULL) arena->current->next = chunk;
+            else arena->chunks = chunk;
+            next = chunk;
+        }
+        arena->current = next;
+        arena->cur = (char*)next->data;
+        arena->left = next->size;
+    }
+    void *p = arena->cur;
+    arena->cur += size;
+    arena->left -= size;
+    arena->used_bytes += size;
+    return p;
+}
+
+
+// Initialize an empty arena that allocates chunks of chunk_size bytes (0 for the default size)
+void arena_init(arena_allocator *arena, size_t chunk_size) {
+    arena->base.alloc = arena_alloc;
+    arena->base.free = NULL; // individual frees are no-ops
+    arena->chunks = NULL;
+    arena->current = NULL;
+    arena->cur = NULL;
+    arena->left = 0;
+    arena->chunk_size = chunk_size > 0 ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+    arena->used_bytes = 0;
+}
+
+
+// Drop everything allocated from the arena in O(1), keeping its chunks to be reused by the next allocations.
+// Everything allocated from it becomes invalid
+void arena_reset(arena_allocator *arena) {
+    arena->current = NULL;
+    arena->cur = NULL;
+    arena->left = 0;
+    arena->used_bytes = 0;
+}
+
+
+// Give back all memory of the arena to the system, in O(number of chunks). Everything allocated from it becomes invalid
+void arena_release(arena_allocator *arena) {
+    while (arena->chunks != NULL) {
+        arena_chunk *next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+    arena_init(arena, arena->chunk_size);
+}
+
+
+
+// Tracking allocator: forwards to a parent allocator (NULL for malloc()/free()) and counts bytes
+typedef struct tracking_allocator {
+    allocator base;
+    allocator *parent;
+    size_t live_bytes;
+    size_t peak_bytes;
+    long allocations;
+    long frees;
+} tracking_allocator;
+
+
+void* tracking_alloc(allocator *a, size_t size) {
+    tracking_allocator *t = (tracking_allocator*)a;
+    void *p = t->parent == NULL ? malloc(size) : t->parent->alloc(t->parent, size);
+    if (p == NULL) return NULL;
+    t->live_bytes += size;
+    if (t->live_bytes > t->peak_bytes) t->peak_bytes = t->live_bytes;
+    t->allocations++;
+    return p;
+}
+
+
+void tracking_free(allocator *a, void *p, size_t size) {
+    tracking_allocator *t = (tracking_allocator*)a;
+    if (t->parent == NULL) free(p);
+    else if (t->parent->free != NULL) t->parent->free(t->parent, p, size);
+    t->live_bytes -= size;
+    t->frees++;
+}
+
+
+// Initialize a tracking allocator on top of parent (NULL for malloc()/free())
+void tracking_init(tracking_allocator *t, allocator *parent) {
+    t->base.alloc = tracking_alloc;
+    t->base.free = tracking_free;
+    t->parent = parent;
+    t->live_bytes = 0;
+    t->peak_bytes = 0;
+    t->allocations = 0;
+    t->frees = 0;
+}
+
+
+// Print the memory used by the container that allocates from t, which holds the given number of elements
+void tracking_report(tracking_allocator *t, const char *name, long elements) {
+    printf("%s: %zu live bytes, %zu peak bytes, %ld allocations, %ld frees", name, t->live_bytes, t->peak_bytes, t->allocations, t->frees);
+    if (elements > 0) printf(", %.1f bytes per element", (double)t->live_bytes / elements);
+    printf("\n");
+}
+
+#endif
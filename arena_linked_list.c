@@ -0,0 +1,357 @@
+/*
+Arena Linked List - index-based linked list storage
+
+In linked_list.c, stack_LL.c and queueLL.c every node is its own malloc() of a 16-byte struct
+(4-byte int + 4 bytes of padding + 8-byte ptr), and the allocator adds its own header on top of that.
+Here all nodes of a list live in one contiguous, growable array (the arena), and a node links to the
+next one by its 32-bit index in that array instead of by an 8-byte ptr:
+- a node is 8 bytes (4-byte int + 4-byte index), half of the ptr-based node, with no per-node allocator header
+- consecutive inserts sit next to each other in memory, so traversals touch far fewer cache lines
+- destroying the list is a single free() of the arena, O(1), instead of freeing nodes one by one
+
+Because links are indices and not addresses, the arena can be moved by realloc() when it grows and every link
+stays valid. The index NIL (UINT32_MAX) plays the role of NULL.
+
+Deleted nodes are not returned to malloc. They are put on a free list (linked through the same next field)
+and reused by the following inserts.
+
+The same list doubles as a stack (push/pop at the beginning) and as a queue (enqueue at the end using the
+tail index, dequeue at the beginning), all in O(1), which covers what stack_LL.c and queueLL.c do.
+
+---IMPLEMENTED OPERATIONS---
+
+1. Insert node:
+- at the beginning
+- at the end (O(1), using the tail index)
+- at nth position
+
+2. Delete node:
+- at the beginning
+- at the end
+- at nth position
+
+3. Access node: given n, return index of node at nth position
+
+4. Search node (linear search)
+
+5. Print the entire linked list data
+
+6. Get length of a linked list (cached)
+
+7. Reverse a linked list
+
+8. Stack (push/pop/top) and queue (enqueue/dequeue/front) operations
+
+9. Destroy the list in O(1)
+
+10. Allocate the arena from a pluggable allocator (alist_allocator), e.g. a tracking allocator that reports the memory
+used by the list, including the arena slots not in use yet (see "allocator.h")
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "counters.h"
+#include "allocator.h"
+
+#define NIL UINT32_MAX // "null" index
+#define ARENA_INITIAL_CAPACITY 16
+#define ARENA_MAX_CAPACITY ((uint32_t)INT_MAX) // length is an int, and every index must stay below NIL
+
+// Node struct. next is the index of the next node in the arena, not a ptr
+typedef struct node {
+    int data;
+    uint32_t next;
+} node;
+
+// List handle owning the arena of nodes
+typedef struct alist {
+    node *nodes;       // the arena
+    uint32_t capacity; // number of nodes the arena can hold
+    uint32_t used;     // number of arena slots handed out so far (live or on the free list)
+    uint32_t free;     // index of the first recycled node, or NIL
+    uint32_t head;
+    uint32_t tail;
+    int length;
+} alist;
+
+// Allocator for the arenas (NULL for malloc()/realloc()/free()). Set it before the first insert
+allocator *alist_allocator;
+
+
+// Initialize an empty list. The arena is only allocated on the first insert
+void alist_init(alist *list) {
+    list->nodes = NULL;
+    list->capacity = 0;
+    list->used = 0;
+    list->free = NIL;
+    list->head = NIL;
+    list->tail = NIL;
+    list->length = 0;
+}
+
+
+// Get a node from the free list or from the arena, growing the arena if needed. Returns its index
+uint32_t alloc_node(alist *list, int x) {
+    uint32_t idx;
+    if (list->free != NIL) {
+        idx = list->free;
+        list->free = list->nodes[idx].next;
+    }
+    else {
+        if (list->used == list->capacity) {
+            if (list->capacity >= ARENA_MAX_CAPACITY) {
+                printf("Out of memory. Arena is at its maximum of %u nodes.\n", list->capacity);
+                return NIL;
+            }
+            uint32_t new_capacity = list->capacity == 0 ? ARENA_INITIAL_CAPACITY : list->capacity * 2;
+            if (list->capacity > ARENA_MAX_CAPACITY / 2) new_capacity = ARENA_MAX_CAPACITY; // doubling would overflow
+            node *new_nodes = (node*)ds_realloc(alist_allocator, list->nodes, sizeof(node) * list->capacity, sizeof(node) * new_capacity);
+            if (new_nodes == NULL) {
+                printf("Out of memory. Cannot grow arena to %u nodes.\n", new_capacity);
+                return NIL;
+            }
+            list->nodes = new_nodes; // all links are indices, so they stay valid after realloc moves the arena
+            list->capacity = new_capacity;
+        }
+        idx = list->used++;
+    }
+    list->nodes[idx].data = x;
+    list->nodes[idx].next = NIL;
+    return idx;
+}
+
+
+// Put a node on the free list so the next insert can reuse it
+void free_node(alist *list, uint32_t idx) {
+    list->nodes[idx].next = list->free;
+    list->free = idx;
+}
+
+
+// Print full LL
+void printLL(alist *list) {
+    if (list->head == NIL) {
+        printf("Linked List is empty!\n");
+        return;
+    }
+    printf("\n--Start LL--\n");
+    for (uint32_t i = list->head; i != NIL; i = list->nodes[i].next) {
+        printf("Data: %d\n", list->nodes[i].data);
+    }
+    printf("--End LL--\n\n");
+}
+
+
+// Insert node at beginning of LL
+void insert_beg(alist *list, int x) {
+    uint32_t idx = alloc_node(list, x);
+    if (idx == NIL) return;
+    list->nodes[idx].next = list->head;
+    list->head = idx;
+    if (list->tail == NIL) list->tail = idx;
+    list->length++;
+}
+
+
+// Insert node at end of LL in O(1)
+void insert_end(alist *list, int x) {
+    uint32_t idx = alloc_node(list, x);
+    if (idx == NIL) return;
+    if (list->tail == NIL) list->head = idx;
+    else list->nodes[list->tail].next = idx;
+    list->tail = idx;
+    list->length++;
+}
+
+
+// Delete node at beginning of LL
+void delete_beg(alist *list) {
+    if (list->head == NIL) {
+        printf("LL is empty. Nothing to delete.\n");
+        return;
+    }
+    uint32_t first = list->head;
+    list->head = list->nodes[first].next;
+    if (list->head == NIL) list->tail = NIL;
+    free_node(list, first);
+    list->length--;
+}
+
+
+// Get index of node at nth position (n>0), or NIL if there is no such node
+uint32_t get_nodei(alist *list, int n) {
+    if (n < 1 || n > list->length) {
+        printf("LL has %d nodes, no node at position %d\n", list->length, n);
+        return NIL;
+    }
+    uint32_t idx = list->head;
+    COUNT(searches);
+    for (int i = 1; i < n; i++) idx = list->nodes[idx].next;
+    COUNT_ADD(nodes_visited, n - 1);
+    return idx;
+}
+
+
+// Delete node at end of LL. Singly linked, so we still have to walk to the second last node
+void delete_end(alist *list) {
+    if (list->head == NIL) {
+        printf("LL is empty. Nothing to delete.\n");
+        return;
+    }
+    if (list->length == 1) {
+        delete_beg(list);
+        return;
+    }
+    uint32_t second_last = get_nodei(list, list->length - 1);
+    free_node(list, list->tail);
+    list->nodes[second_last].next = NIL;
+    list->tail = second_last;
+    list->length--;
+}
+
+
+// Insert node at position n (1 <= n <= length+1) with the data x
+void insert_node(alist *list, int n, int x) {
+    if (n < 1 || n > list->length + 1) {
+        printf("LL too small for a node to be added at %dth position\n", n);
+        return;
+    }
+    if (n == 1) {
+        insert_beg(list, x);
+        return;
+    }
+    if (n == list->length + 1) {
+        insert_end(list, x);
+        return;
+    }
+    uint32_t prev = get_nodei(list, n - 1);
+    uint32_t idx = alloc_node(list, x);
+    if (idx == NIL) return;
+    list->nodes[idx].next = list->nodes[prev].next;
+    list->nodes[prev].next = idx;
+    list->length++;
+}
+
+
+// Delete node at position n
+void delete_node(alist *list, int n) {
+    if (n < 1 || n > list->length) {
+        printf("Cannot delete node at position %d for a LL of length %d\n", n, list->length);
+        return;
+    }
+    if (n == 1) {
+        delete_beg(list);
+        return;
+    }
+    uint32_t prev = get_nodei(list, n - 1);
+    uint32_t del = list->nodes[prev].next;
+    list->nodes[prev].next = list->nodes[del].next;
+    if (del == list->tail) list->tail = prev;
+    free_node(list, del);
+    list->length--;
+}
+
+
+// Linear search. Returns index of the first node holding data, or NIL if not found
+uint32_t search_data(alist *list, int data) {
+    COUNT(searches);
+    for (uint32_t i = list->head; i != NIL; i = list->nodes[i].next) {
+        COUNT(nodes_visited);
+        if (list->nodes[i].data == data) return i;
+    }
+    return NIL;
+}
+
+
+// Get number of nodes in LL
+int get_length(alist *list) {
+    return list->length;
+}
+
+
+// Reverse LL
+void reverseLL(alist *list) {
+    uint32_t prev = NIL, cur = list->head;
+    list->tail = cur;
+    while (cur != NIL) {
+        uint32_t next = list->nodes[cur].next;
+        list->nodes[cur].next = prev;
+        prev = cur;
+        cur = next;
+    }
+    list->head = prev;
+}
+
+
+// Destroy the list in O(1): one free() releases every node at once
+void destroy(alist *list) {
+    ds_free(alist_allocator, list->nodes, sizeof(node) * list->capacity);
+    alist_init(list);
+}
+
+
+// Stack operations: push and pop at the beginning of the list
+void push(alist *stack, int x) { insert_beg(stack, x); }
+void pop(alist *stack) { delete_beg(stack); }
+
+// Queue operations: enqueue at the end (tail index), dequeue at the beginning
+void enqueue(alist *queue, int x) { insert_end(queue, x); }
+void dequeue(alist *queue) { delete_beg(queue); }
+
+// Return true if the list/stack/queue is empty, false otherwise
+bool is_empty(alist *list) {
+    return list->head == NIL;
+}
+
+// Return element at the top of the stack, or at the front of the queue
+int _top(alist *list) {
+    if (list->head == NIL) {
+        printf("List is empty. Returning -1.\n");
+        return -1;
+    }
+    return list->nodes[list->head].data;
+}
+
+
+
+int main() {
+    // Allocate the arenas through a tracking allocator, to see how much memory the list uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    alist_allocator = &tracker.base;
+    alist list;
+    alist_init(&list);
+    int data_elements;
+    int x;
+    printf("Enter number of elements to add to LL: ");
+    scanf("%d", &data_elements);
+    for (int i=0; i<data_elements; i++) {
+        printf("Enter number to add to end of LL: ");
+        scanf("%d", &x);
+        insert_end(&list, x);
+    }
+
+    insert_node(&list, 2, 99);
+    printLL(&list);
+    delete_end(&list);
+    reverseLL(&list);
+    printLL(&list);
+    printf("LL has %d nodes, 99 is %sfound\n", get_length(&list), search_data(&list, 99) == NIL ? "not " : "");
+    printf("Bytes per node: %zu (ptr-based node: %zu)\n", sizeof(node), sizeof(struct { int data; void *next; }));
+    tracking_report(&tracker, "Arena LL", get_length(&list));
+    counters_print();
+    destroy(&list);
+
+    // The same storage as a queue
+    alist queue;
+    alist_init(&queue);
+    for (int i = 1; i <= 3; i++) enqueue(&queue, i);
+    dequeue(&queue);
+    printf("Front of queue: %d\n", _top(&queue));
+    destroy(&queue);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,618 @@
+/*
+Adaptive radix tree (ART) for int keys
+
+A BST compares the search key with one key per level, and every level is a dependent load of a node that is
+probably not in the cache: about log2(n) cache misses per lookup (20 for a million keys). A radix tree (trie)
+instead looks at the key one byte at a time: the byte at each level directly selects the child, without any
+comparison with other keys. A lookup visits at most one node per key byte, i.e. at most 4 nodes for an int key,
+however many keys the tree holds, and the tree keeps its keys in order, so it also supports min/max and range scans.
+
+A trie with 256 child ptrs per node would waste most of its memory on NULL ptrs. ART adapts the node size to the
+number of children:
+- Node4:   up to 4 children, with a sorted array of 4 key bytes and 4 child ptrs (48 bytes)
+- Node16:  up to 16 children, the same with 16 (152 bytes). The key bytes are searched with one SIMD compare
+- Node48:  up to 48 children, with a 256-entry array indexed by key byte, holding the index of the child ptr (648 bytes)
+- Node256: 256 child ptrs, indexed by key byte (2056 bytes)
+A node grows to the next type when it is full.
+
+Two more techniques keep the tree short and small:
+- lazy expansion: a subtree with a single key is just a leaf, placed as high up as possible
+- path compression: a chain of nodes with a single child is collapsed into one node, which stores the key bytes
+  of the chain (its prefix) and checks them all at once
+Leaves hold nothing but the key, so we do not allocate them at all: a leaf is the key itself, stored in the child
+ptr with the lowest bit set (real node ptrs are aligned, so their lowest bit is 0). Memory per key then comes only
+from the inner nodes, shared by all keys below them: often less than the 24 bytes (and one malloc) per key of a
+BST node with 2 ptrs.
+
+Key bytes are taken most significant first, after flipping the sign bit, so that the byte order of the keys is
+the same as the order of the ints (negative keys first). Keys are unique: inserting a key twice is a no-op.
+A 64-bit key would not fit next to the tag bit in a ptr, and would need real leaf objects.
+
+---IMPLEMENTED OPERATIONS---
+1. Insert
+2. Search (lookup)
+3. Range query: report all keys in [lo, hi], in order
+4. Find minimum and maximum key
+5. Find number of keys (size) and height
+6. In-order traversal
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+_Static_assert(sizeof(uintptr_t) >= 8, "leaves store a 32-bit key next to a tag bit in a ptr");
+
+#define KEY_BYTES 4
+
+enum node_type {
+    NODE4,
+    NODE16,
+    NODE48,
+    NODE256
+};
+
+// Header shared by all inner node types
+typedef struct art_node {
+    uint8_t type;
+    uint8_t prefix_len;    // number of compressed key bytes in prefix (at most KEY_BYTES - 1)
+    uint16_t num_children;
+    uint8_t prefix[KEY_BYTES];
+} art_node;
+
+typedef struct node4 {
+    art_node header;
+    uint8_t keys[4];        // key bytes of the children, sorted
+    art_node *children[4];
+} node4;
+
+typedef struct node16 {
+    art_node header;
+    uint8_t keys[16];       // key bytes of the children, sorted
+    art_node *children[16];
+} node16;
+
+typedef struct node48 {
+    art_node header;
+    uint8_t child_index[256]; // index + 1 into children for each key byte, 0 if there is no child
+    art_node *children[48];
+} node48;
+
+typedef struct node256 {
+    art_node header;
+    art_node *children[256];
+} node256;
+
+const size_t node_sizes[] = {sizeof(node4), sizeof(node16), sizeof(node48), sizeof(node256)};
+
+// Called with every key reported by a range query. ctx is passed through from the query
+typedef void (*report_fn)(int key, void *ctx);
+
+// Allocator for the inner nodes (NULL for malloc()/free()). Set it before the first insert
+allocator *art_allocator;
+
+
+
+// Map an int to an unsigned key whose order is the same as the order of the ints
+uint32_t to_ukey(int key) {
+    return (uint32_t)key ^ 0x80000000u;
+}
+
+int from_ukey(uint32_t ukey) {
+    return (int)(ukey ^ 0x80000000u);
+}
+
+
+// Byte of the key at depth (0 is the most significant byte)
+uint8_t key_byte(uint32_t ukey, int depth) {
+    return (uint8_t)(ukey >> (8 * (KEY_BYTES - 1 - depth)));
+}
+
+
+// Leaves are tagged ptrs that hold the key
+bool is_leaf(art_node *n) {
+    return ((uintptr_t)n & 1) != 0;
+}
+
+art_node* make_leaf(uint32_t ukey) {
+    return (art_node*)(((uintptr_t)ukey << 1) | 1);
+}
+
+uint32_t leaf_key(art_node *n) {
+    return (uint32_t)((uintptr_t)n >> 1);
+}
+
+
+// Allocate an empty inner node of the given type
+art_node* alloc_node(uint8_t type) {
+    art_node *n = (art_node*)ds_alloc(art_allocator, node_sizes[type]);
+    memset(n, 0, node_sizes[type]);
+    n->type = type;
+    return n;
+}
+
+
+// Return a ptr to the child ptr for key byte b, or NULL if there is no such child
+art_node** find_child(art_node *n, uint8_t b) {
+    switch (n->type) {
+        case NODE4: {
+            node4 *n4 = (node4*)n;
+            for (int i = 0; i < n->num_children; i++) {
+                if (n4->keys[i] == b) return &n4->children[i];
+            }
+            return NULL;
+        }
+        case NODE16: {
+            node16 *n16 = (node16*)n;
+#if defined(__SSE2__)
+            // Compare b with all 16 key bytes at once, and keep the matches among the used slots
+            __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)b), _mm_loadu_si128((__m128i*)n16->keys));
+            int mask = _mm_movemask_epi8(cmp) & ((1 << n->num_children) - 1);
+            return mask ? &n16->children[__builtin_ctz(mask)] : NULL;
+#else
+            for (int i = 0; i < n->num_children; i++) {
+                if (n16->keys[i] == b) return &n16->children[i];
+            }
+            return NULL;
+#endif
+        }
+        case NODE48: {
+            node48 *n48 = (node48*)n;
+            return n48->child_index[b] ? &n48->children[n48->child_index[b] - 1] : NULL;
+        }
+        default: {
+            node256 *n256 = (node256*)n;
+            return n256->children[b] ? &n256->children[b] : NULL;
+        }
+    }
+}
+
+
+// Add child for key byte b to the node *ref, replacing it with a node of the next size if it is full
+void add_child(art_node **ref, uint8_t b, art_node *child) {
+    art_node *n = *ref;
+    switch (n->type) {
+        case NODE4:
+        case NODE16: {
+            int capacity = (n->type == NODE4) ? 4 : 16;
+            uint8_t *keys = (n->type == NODE4) ? ((node4*)n)->keys : ((node16*)n)->keys;
+            art_node **children = (n->type == NODE4) ? ((node4*)n)->children : ((node16*)n)->children;
+            if (n->num_children < capacity) {
+                // Insert in sorted position, shifting the larger key bytes up
+                int i = n->num_children;
+                while (i > 0 && keys[i - 1] > b) {
+                    keys[i] = keys[i - 1];
+                    children[i] = children[i - 1];
+                    i--;
+                }
+                keys[i] = b;
+                children[i] = child;
+                n->num_children++;
+                return;
+            }
+            // Full: grow to the next node type
+            art_node *bigger = alloc_node(n->type == NODE4 ? NODE16 : NODE48);
+            bigger->prefix_len = n->prefix_len;
+            memcpy(bigger->prefix, n->prefix, KEY_BYTES);
+            bigger->num_children = n->num_children;
+            if (n->type == NODE4) {
+                memcpy(((node16*)bigger)->keys, keys, capacity);
+                memcpy(((node16*)bigger)->children, children, sizeof(art_node*) * capacity);
+            }
+            else {
+                for (int i = 0; i < capacity; i++) {
+                    ((node48*)bigger)->child_index[keys[i]] = i + 1;
+                    ((node48*)bigger)->children[i] = children[i];
+                }
+            }
+            ds_free(art_allocator, n, node_sizes[n->type]);
+            *ref = bigger;
+            add_child(ref, b, child);
+            return;
+        }
+        case NODE48: {
+            node48 *n48 = (node48*)n;
+            if (n->num_children < 48) {
+                n48->children[n->num_children] = child; // keys are never deleted, so the used slots are 0..num_children-1
+                n48->child_index[b] = ++n->num_children;
+                return;
+            }
+            node256 *bigger = (node256*)alloc_node(NODE256);
+            bigger->header.prefix_len = n->prefix_len;
+            memcpy(bigger->header.prefix, n->prefix, KEY_BYTES);
+            bigger->header.num_children = n->num_children;
+            for (int k = 0; k < 256; k++) {
+                if (n48->child_index[k]) bigger->children[k] = n48->children[n48->child_index[k] - 1];
+            }
+            ds_free(art_allocator, n, sizeof(node48));
+            *ref = (art_node*)bigger;
+            add_child(ref, b, child);
+            return;
+        }
+        default: {
+            ((node256*)n)->children[b] = child;
+            n->num_children++;
+        }
+    }
+}
+
+
+// Insert ukey into the subtree *ref, whose keys agree with ukey on the first depth bytes. Returns false if it was already there
+bool insert_at(art_node **ref, uint32_t ukey, int depth) {
+    art_node *n = *ref;
+    if (n == NULL) {
+        *ref = make_leaf(ukey);
+        return true;
+    }
+
+    if (is_leaf(n)) {
+        // Lazy expansion: the leaf becomes a Node4 with both keys below it, prefixed by the bytes they share
+        uint32_t other = leaf_key(n);
+        if (other == ukey) return false;
+        art_node *new_node = alloc_node(NODE4);
+        int shared = 0;
+        while (key_byte(ukey, depth + shared) == key_byte(other, depth + shared)) {
+            new_node->prefix[shared] = key_byte(ukey, depth + shared);
+            shared++;
+        }
+        new_node->prefix_len = shared;
+        *ref = new_node;
+        add_child(ref, key_byte(ukey, depth + shared), make_leaf(ukey));
+        add_child(ref, key_byte(other, depth + shared), n);
+        return true;
+    }
+
+    if (n->prefix_len > 0) {
+        int matched = 0;
+        while (matched < n->prefix_len && n->prefix[matched] == key_byte(ukey, depth + matched)) matched++;
+        if (matched < n->prefix_len) {
+            // The key leaves the compressed path: split it with a new Node4 holding the matched part of the prefix
+            art_node *new_node = alloc_node(NODE4);
+            new_node->prefix_len = matched;
+            memcpy(new_node->prefix, n->prefix, matched);
+            uint8_t old_byte = n->prefix[matched];
+            n->prefix_len -= matched + 1; // the matched bytes move up, the next byte becomes n's key byte in new_node
+            memmove(n->prefix, n->prefix + matched + 1, n->prefix_len);
+            *ref = new_node;
+            add_child(ref, old_byte, n);
+            add_child(ref, key_byte(ukey, depth + matched), make_leaf(ukey));
+            return true;
+        }
+        depth += n->prefix_len;
+    }
+
+    art_node **child = find_child(n, key_byte(ukey, depth));
+    if (child != NULL) return insert_at(child, ukey, depth + 1);
+    add_child(ref, key_byte(ukey, depth), make_leaf(ukey));
+    return true;
+}
+
+
+// Insert key into the tree. Returns false if it was already there
+bool insert(art_node **root, int key) {
+    return insert_at(root, to_ukey(key), 0);
+}
+
+
+// Search for key in the tree. Returns true if found
+bool search(art_node **root, int key) {
+    COUNT(searches);
+    uint32_t ukey = to_ukey(key);
+    art_node *n = *root;
+    int depth = 0;
+    while (n != NULL) {
+        if (is_leaf(n)) return leaf_key(n) == ukey; // the key is in the tagged ptr, no node to read
+        COUNT(nodes_visited);
+        for (int i = 0; i < n->prefix_len; i++) {
+            if (n->prefix[i] != key_byte(ukey, depth + i)) return false;
+        }
+        depth += n->prefix_len;
+        art_node **child = find_child(n, key_byte(ukey, depth));
+        if (child == NULL) return false;
+        n = *child;
+        depth++;
+    }
+    return false;
+}
+
+
+// Return the child of n at position i in key byte order (i counts all 256 possible key bytes for Node48/256),
+// or NULL. Used to walk the children in order
+art_node* child_at(art_node *n, int i, int *key_byte_out) {
+    switch (n->type) {
+        case NODE4:
+            if (i >= n->num_children) return NULL;
+            *key_byte_out = ((node4*)n)->keys[i];
+            return ((node4*)n)->children[i];
+        case NODE16:
+            if (i >= n->num_children) return NULL;
+            *key_byte_out = ((node16*)n)->keys[i];
+            return ((node16*)n)->children[i];
+        case NODE48: {
+            node48 *n48 = (node48*)n;
+            *key_byte_out = i;
+            return (i < 256 && n48->child_index[i]) ? n48->children[n48->child_index[i] - 1] : NULL;
+        }
+        default:
+            *key_byte_out = i;
+            return (i < 256) ? ((node256*)n)->children[i] : NULL;
+    }
+}
+
+
+// Number of positions to try with child_at()
+int child_positions(art_node *n) {
+    return (n->type == NODE4 || n->type == NODE16) ? n->num_children : 256;
+}
+
+
+// Report all keys in [lo, hi] of the subtree n at depth, in order. lo_tight (hi_tight) is true if the key bytes
+// above n are equal to those of lo (hi), so that the bytes of lo (hi) at this level still limit which children
+// to visit. Returns the number of keys reported
+long range_at(art_node *n, int depth, uint32_t lo, uint32_t hi, bool lo_tight, bool hi_tight, report_fn report, void *ctx) {
+    if (is_leaf(n)) {
+        uint32_t ukey = leaf_key(n);
+        if (ukey < lo || ukey > hi) return 0;
+        if (report != NULL) report(from_ukey(ukey), ctx);
+        return 1;
+    }
+    COUNT(nodes_visited);
+    for (int i = 0; i < n->prefix_len; i++, depth++) {
+        if (lo_tight) {
+            if (n->prefix[i] < key_byte(lo, depth)) return 0; // whole subtree below lo
+            if (n->prefix[i] > key_byte(lo, depth)) lo_tight = false;
+        }
+        if (hi_tight) {
+            if (n->prefix[i] > key_byte(hi, depth)) return 0; // whole subtree above hi
+            if (n->prefix[i] < key_byte(hi, depth)) hi_tight = false;
+        }
+    }
+    long reported = 0;
+    int positions = child_positions(n);
+    for (int i = 0; i < positions; i++) {
+        int b;
+        art_node *child = child_at(n, i, &b);
+        if (child == NULL) continue;
+        if (lo_tight && b < key_byte(lo, depth)) continue;
+        if (hi_tight && b > key_byte(hi, depth)) break;
+        reported += range_at(child, depth + 1, lo, hi, lo_tight && b == key_byte(lo, depth),
+                             hi_tight && b == key_byte(hi, depth), report, ctx);
+    }
+    return reported;
+}
+
+
+// Report all keys in [lo, hi], in increasing order. Returns the number of keys reported
+long range_query(art_node **root, int lo, int hi, report_fn report, void *ctx) {
+    if (*root == NULL || lo > hi) return 0;
+    return range_at(*root, 0, to_ukey(lo), to_ukey(hi), true, true, report, ctx);
+}
+
+
+// Return the first (smallest == true) or last child of n in key byte order
+art_node* extreme_child(art_node *n, bool smallest) {
+    int positions = child_positions(n);
+    for (int k = 0; k < positions; k++) {
+        int b;
+        art_node *child = child_at(n, smallest ? k : positions - 1 - k, &b);
+        if (child != NULL) return child;
+    }
+    return NULL;
+}
+
+
+// Get minimum key in the tree
+int get_min(art_node **root) {
+    if (*root == NULL) {
+        printf("Empty ART, returning -1\n");
+        return -1;
+    }
+    art_node *n = *root;
+    while (!is_leaf(n)) n = extreme_child(n, true);
+    return from_ukey(leaf_key(n));
+}
+
+
+// Get maximum key in the tree
+int get_max(art_node **root) {
+    if (*root == NULL) {
+        printf("Empty ART, returning -1\n");
+        return -1;
+    }
+    art_node *n = *root;
+    while (!is_leaf(n)) n = extreme_child(n, false);
+    return from_ukey(leaf_key(n));
+}
+
+
+// Get number of keys in the tree
+long get_size(art_node **root) {
+    return range_query(root, INT32_MIN, INT32_MAX, NULL, NULL);
+}
+
+
+// Return maximum of 2 integers
+int max(int x, int y) {
+    return (x>=y)?x:y;
+}
+
+
+// Get height of the tree: the number of inner nodes on the longest path to a leaf (at most KEY_BYTES)
+int get_height(art_node **root) {
+    if (*root == NULL || is_leaf(*root)) return 0;
+    int height = 0;
+    int positions = child_positions(*root);
+    for (int i = 0; i < positions; i++) {
+        int b;
+        art_node *child = child_at(*root, i, &b);
+        if (child != NULL) height = max(height, get_height(&child));
+    }
+    return 1 + height;
+}
+
+
+// Print a key
+void print_key(int key, void *ctx) {
+    (void)ctx;
+    printf(" %d", key);
+}
+
+
+// In-order traversal, printing on one line
+void in_order(art_node **root) {
+    range_query(root, INT32_MIN, INT32_MAX, print_key, NULL);
+}
+
+
+// Free all inner nodes of the tree
+void free_art(art_node **root) {
+    if (*root == NULL || is_leaf(*root)) {
+        *root = NULL;
+        return;
+    }
+    int positions = child_positions(*root);
+    for (int i = 0; i < positions; i++) {
+        int b;
+        art_node *child = child_at(*root, i, &b);
+        if (child != NULL) free_art(&child);
+    }
+    ds_free(art_allocator, *root, node_sizes[(*root)->type]);
+    *root = NULL;
+}
+
+
+
+// Plain BST node, to compare with
+typedef struct bst_node {
+    int data;
+    struct bst_node *left;
+    struct bst_node *right;
+} bst_node;
+
+
+// Insert into a plain BST (no duplicates), allocating from alloc
+void bst_insert(bst_node **root, int data, allocator *alloc) {
+    while (*root != NULL) {
+        if (data == (*root)->data) return;
+        root = (data < (*root)->data) ? &((*root)->left) : &((*root)->right);
+    }
+    *root = (bst_node*)ds_alloc(alloc, sizeof(bst_node));
+    (*root)->data = data;
+    (*root)->left = NULL;
+    (*root)->right = NULL;
+}
+
+
+// Search a plain BST
+bool bst_search(bst_node **root, int data) {
+    bst_node *temp = *root;
+    while (temp != NULL) {
+        if (data == temp->data) return true;
+        temp = (data < temp->data) ? temp->left : temp->right;
+    }
+    return false;
+}
+
+
+// Free a plain BST
+void bst_free(bst_node *root, allocator *alloc) {
+    while (root != NULL) {
+        bst_free(root->left, alloc);
+        bst_node *right = root->right;
+        ds_free(alloc, root, sizeof(bst_node));
+        root = right;
+    }
+}
+
+
+// Benchmark: insert n keys in random order into an ART and a plain BST, then look up n keys (half of them present)
+// in random order. Keys are either random ints or dense (0..n-1, shuffled)
+void compare_with_bst(int n, bool dense) {
+    int *keys = (int*)malloc(sizeof(int) * n);
+    unsigned int state = 2463534242u;
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5; // xorshift32
+        keys[i] = dense ? i : (int)state;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        int j = state % (unsigned int)(i + 1);
+        int temp = keys[i]; keys[i] = keys[j]; keys[j] = temp;
+    }
+
+    allocator *saved_allocator = art_allocator;
+    tracking_allocator art_tracker, bst_tracker;
+    tracking_init(&art_tracker, NULL);
+    tracking_init(&bst_tracker, NULL);
+    art_allocator = &art_tracker.base;
+    art_node *art_root = NULL;
+    bst_node *bst_root = NULL;
+
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) insert(&art_root, keys[i]);
+    double art_insert_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int i = 0; i < n; i++) bst_insert(&bst_root, keys[i], &bst_tracker.base);
+    double bst_insert_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    long art_found = 0;
+    for (int i = 0; i < n; i++) art_found += search(&art_root, keys[(i * 7919L) % n] + (i & 1) * 3);
+    double art_search_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    long bst_found = 0;
+    for (int i = 0; i < n; i++) bst_found += bst_search(&bst_root, keys[(i * 7919L) % n] + (i & 1) * 3);
+    double bst_search_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("\n%d %s keys: ART height %d, %ld keys\n", n, dense ? "dense" : "random", get_height(&art_root), get_size(&art_root));
+    printf("ART: insert %.3f s, lookup %.3f s (%ld found)\n", art_insert_secs, art_search_secs, art_found);
+    printf("BST: insert %.3f s, lookup %.3f s (%ld found)\n", bst_insert_secs, bst_search_secs, bst_found);
+    tracking_report(&art_tracker, "ART", n);
+    tracking_report(&bst_tracker, "BST", n);
+
+    free_art(&art_root);
+    bst_free(bst_root, &bst_tracker.base);
+    art_allocator = saved_allocator;
+    free(keys);
+}
+
+
+
+int main() {
+    art_node *root = NULL; // Empty ART
+    int n, x;
+
+    printf("Enter the number of keys to insert: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter key to insert: ");
+        scanf("%d", &x);
+        insert(&root, x);
+    }
+
+    int demo_keys[] = {42, -7, 1000, 1001, 65536, 65537, 1 << 24, -2000000000, 2000000000, 300};
+    for (int i = 0; i < 10; i++) insert(&root, demo_keys[i]);
+    printf("\nKeys in order:");
+    in_order(&root);
+    printf("\nSize: %ld, height: %d, min: %d, max: %d\n", get_size(&root), get_height(&root), get_min(&root), get_max(&root));
+    printf("Is 1001 in the ART? %d. Is 1002? %d\n", search(&root, 1001), search(&root, 1002));
+    printf("Keys in [0, 70000]:");
+    long found = range_query(&root, 0, 70000, print_key, NULL);
+    printf(" (%ld)\n", found);
+    free_art(&root);
+
+    compare_with_bst(1 << 20, false);
+    compare_with_bst(1 << 20, true);
+    counters_print();
+
+    return EXIT_SUCCESS;
+}
@@ -30,35 +30,90 @@ of the tree can be applied to the roots of its subtrees, and so on.
     - In-order traversal
     - Pre-order traversal
     - Post-order traversal
-7. Breadth-first traversal - Use the queue function implemented before (appropriately modified to store node* instead of int in queue). Include the "queue.h" header in the current directory
+7. Breadth-first traversal - Keep the nodes of the current and the next level in two small-buffer-optimized stacks (see "sbo_stack.h"),
+   so that no level is too wide
 8. Check if a binary tree is a binary search tree
+9. Save a binary tree to a snapshot file, and search a BST snapshot in place after mapping it with mmap (see "snapshot.h")
+10. Build a balanced BST from a sorted array in O(n)
+11. Bulk load data from a file or stdin: run the program with the file name as its argument ("-" for stdin) (see "bulk_load.h").
+    The data is sorted and the BST is built balanced in one go, instead of inserting it element by element
+12. Allocate the nodes from a pluggable allocator (bst_allocator), e.g. a tracking allocator that reports the memory used by the tree (see "allocator.h")
+13. Search
+14. Free a tree node by node, or, in arena mode, destroy it in O(1)
+15. Compact a tree: relocate its nodes in in-order or BFS order, for better locality of traversals and searches
+16. Multiset mode: insert_multiset() keeps one node per key with a count of its copies. Size, rank, copies of a key,
+    in-order traversal and snapshots count every copy. Bulk loading builds a multiset. Rank (get_rank()) is O(n): nodes
+    store no subtree sizes, so it sums the left subtrees along the search path node by node
+17. Splay tree mode: top-down splay, search and insert (splay_search(), splay_insert()), so that frequently accessed
+    keys move to the top of the tree. Amortized O(log n) per operation, and close to O(1) for hot keys
+18. Convert to and from a compressed bitmap set of ints (see "roaring.h"), which holds a set of ints in a few bytes
+    (or less) per element instead of a node each, and intersects/unites sets with bitmap operations. The bitmap is a
+    set: the copies counted by a multiset are lost. Converting back builds a balanced BST
+19. Optional Bloom filter in front of search() (bst_filter, see "bloom.h"), set with bst_set_filter(): every new node adds its
+    key to the filter, and a search for a key that was never inserted returns false without walking down the tree
+20. Iterative in-order traversal (in_order_iterative()) with a small-buffer-optimized scratch stack (see "sbo_stack.h"):
+    no allocation while the tree is shallower than SBO_STACK_N, and no depth limit beyond that
+
+Benchmarks: run the program with --bench as its argument to also compare insert() with insert_multiset(), a plain and a
+balanced BST with a splay tree on a Zipf workload, malloc()ed with arena and compacted node layouts, searches with and
+without the Bloom filter, and recursive with iterative in-order traversals. They take several seconds, so a plain run
+skips them.
+
+Compile with -lm (the Zipf workload uses pow(), see "zipf.h")
+
+---ARENA MODE---
+With bst_allocator pointing to an arena_allocator (see "allocator.h"), nodes are carved out of large contiguous chunks
+in allocation order, without a malloc() call (and its per-node header) for every node. Freeing such a tree node by
+node would be an O(n) ptr chase that gives nothing back, so destroy_arena_tree() instead resets the arena in O(1),
+without visiting any node, and keeps the chunks for the next tree.
+Insertion order is rarely a good memory order for a traversal: after random inserts, neighbours in the tree are
+scattered over the chunks. compact_tree() copies a tree into a fresh arena in in-order sequence (a traversal then
+walks memory front to back) or in level order (the top levels, visited by every search, share a few cache lines),
+after which the old arena can be reset.
 */
 
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include "queue.h"
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+#include "snapshot.h"
+#include "bulk_load.h"
+#include "roaring.h"
+#include "bloom.h"
+#include "zipf.h"
+#define SBO_STACK_ELEM struct node*
+#include "sbo_stack.h"
 
 
-#ifndef NODE_STRUCT
-#define NODE_STRUCT
 // Binary Search Tree node
 typedef struct node {
     int data;
+    int count; // number of copies of data (multiset mode, see insert_multiset()). 1 for trees built with insert()
     struct node *left;
     struct node *right;
 } node;
-#endif
+
+// Allocator for the BST nodes (NULL for malloc()/free()). Set it before the first insert
+allocator *bst_allocator;
+
+// Optional Bloom filter of the keys in the BST (NULL for none). Set it with bst_set_filter(). free_tree() does not clear it
+bloom *bst_filter;
 
 
 // Create a new BST node and add data to it
 void create(node **root, int data) {
-    node* new_node = (node*)malloc(sizeof(node));
+    node* new_node = (node*)ds_alloc(bst_allocator, sizeof(node));
     new_node->data = data;
+    new_node->count = 1;
     new_node->left = NULL;
     new_node->right = NULL;
     *root = new_node;
+    bloom_add(bst_filter, data);
 }
 
 
@@ -67,12 +122,160 @@ void insert(node **root, int data) {
     // If BST is empty, create the root node
     if (*root == NULL) {
         create(root, data);
+        COUNT(bst_inserts);
+        return;
     }
-    else if (data <= (*root)->data) insert(&((*root)->left), data); // If input data is less than (or equal to) data in root node, then go to left subtree and try inserting there
+    COUNT(bst_insert_comparisons);
+    if (data <= (*root)->data) insert(&((*root)->left), data); // If input data is less than (or equal to) data in root node, then go to left subtree and try inserting there
     else insert(&((*root)->right), data); // If input data is greater than data in root node, then go to right subtree and try inserting there
 }
 
 
+// Insert data into a multiset BST, where each key has a single node that counts its copies. A duplicate only
+// increments the count of the existing node: no allocation, and no chain of equal keys making the tree taller
+void insert_multiset(node **root, int data) {
+    while (*root != NULL) {
+        COUNT(bst_insert_comparisons);
+        if (data == (*root)->data) {
+            (*root)->count++;
+            COUNT(bst_inserts);
+            return;
+        }
+        root = (data < (*root)->data) ? &((*root)->left) : &((*root)->right);
+    }
+    create(root, data);
+    COUNT(bst_inserts);
+}
+
+
+// Splay tree mode: splay() moves a key to the root, so the next access to it is O(1), and keys that are accessed
+// often stay near the top of the tree. Top-down and non-recursive: a single pass down the search path splits the
+// tree into a left tree (keys smaller than data) and a right tree (keys larger than data), rotating zig-zig steps
+// on the way, then the last node reached becomes the root with the two trees as its subtrees.
+// If data is not in the tree, the last node on its search path (its predecessor or successor) becomes the root
+void splay(node **root, int data) {
+    if (*root == NULL) return;
+    node header; // header.right is the root of the left tree, header.left is the root of the right tree
+    header.left = NULL;
+    header.right = NULL;
+    node *left_max = &header;  // largest node of the left tree, new nodes are linked at its right
+    node *right_min = &header; // smallest node of the right tree, new nodes are linked at its left
+    node *temp = *root;
+
+    COUNT(searches);
+    while (true) {
+        COUNT(nodes_visited);
+        if (data < temp->data) {
+            if (temp->left == NULL) break;
+            if (data < temp->left->data) { // zig-zig: rotate right, so that the path gets shorter
+                node *child = temp->left;
+                temp->left = child->right;
+                child->right = temp;
+                temp = child;
+                if (temp->left == NULL) break;
+            }
+            right_min->left = temp; // temp and its right subtree are larger than data: move them to the right tree
+            right_min = temp;
+            temp = temp->left;
+        }
+        else if (data > temp->data) {
+            if (temp->right == NULL) break;
+            if (data > temp->right->data) { // zig-zig: rotate left
+                node *child = temp->right;
+                temp->right = child->left;
+                child->left = temp;
+                temp = child;
+                if (temp->right == NULL) break;
+            }
+            left_max->right = temp; // temp and its left subtree are smaller than data: move them to the left tree
+            left_max = temp;
+            temp = temp->right;
+        }
+        else break;
+    }
+
+    // Reassemble: temp's subtrees go to the two trees, which become temp's subtrees
+    left_max->right = temp->left;
+    right_min->left = temp->right;
+    temp->left = header.right;
+    temp->right = header.left;
+    *root = temp;
+}
+
+
+// Search for data in a splay tree, moving it (or the last node on its search path) to the root. Returns true if found
+bool splay_search(node **root, int data) {
+    splay(root, data);
+    return *root != NULL && (*root)->data == data;
+}
+
+
+// Insert data into a splay tree, which becomes the root. Duplicates increment the count of the existing node, as in
+// insert_multiset(): rotations could move equal keys to the right, which would break the rule of insert()
+void splay_insert(node **root, int data) {
+    COUNT(bst_inserts);
+    if (*root == NULL) {
+        create(root, data);
+        return;
+    }
+    splay(root, data);
+    if ((*root)->data == data) {
+        (*root)->count++;
+        return;
+    }
+
+    // The old root is data's predecessor or successor: split the tree around it
+    node *old_root = *root;
+    create(root, data);
+    if (data < old_root->data) {
+        (*root)->left = old_root->left;
+        (*root)->right = old_root;
+        old_root->left = NULL;
+    }
+    else {
+        (*root)->right = old_root->right;
+        (*root)->left = old_root;
+        old_root->right = NULL;
+    }
+}
+
+
+// Search for data in BST. Returns true if found. If bst_filter is set, keys it has never seen are rejected without
+// walking down the tree
+bool search(node **root, int data) {
+    COUNT(searches);
+    if (!bloom_maybe_contains(bst_filter, data)) {
+        COUNT(filter_rejections);
+        return false;
+    }
+    node *temp = *root;
+    while (temp != NULL) {
+        COUNT(nodes_visited);
+        if (data == temp->data) return true;
+        temp = (data < temp->data) ? temp->left : temp->right;
+    }
+    return false;
+}
+
+
+// Add the keys of the subtree rooted at root to filter
+void filter_add_subtree(node *root, bloom *filter) {
+    while (root != NULL) {
+        bloom_add(filter, root->data);
+        filter_add_subtree(root->left, filter);
+        root = root->right; // loop instead of recursing on the right subtree
+    }
+}
+
+
+// Put the Bloom filter filter (NULL for none) in front of search(), and add the keys already in the BST to it. Keys
+// inserted before the filter was set would otherwise be rejected as never seen
+void bst_set_filter(node **root, bloom *filter) {
+    bst_filter = filter;
+    if (filter != NULL) filter_add_subtree(*root, filter);
+}
+
+
 // Get minimum element in BST
 int get_min(node **root) {
     if (*root == NULL) {
@@ -114,14 +317,50 @@ int get_height(node **root) {
 }
 
 
-// Get number of elements in a binary tree
+// Get number of elements in a binary tree. Every node holds count copies of its data (1 unless built with insert_multiset())
 int get_size(node **root) {
     if (*root == NULL) return 0; // Returns 0 when tree is empty, or when node is a leaf
 
     int size_left_subtree, size_right_subtree;
     size_left_subtree = get_size(&((*root)->left));
     size_right_subtree = get_size(&((*root)->right));
-    return 1 + size_left_subtree + size_right_subtree;
+    return (*root)->count + size_left_subtree + size_right_subtree;
+}
+
+
+// Get number of nodes in a binary tree. Smaller than get_size() for a multiset with duplicates
+int get_node_count(node **root) {
+    if (*root == NULL) return 0;
+    return 1 + get_node_count(&((*root)->left)) + get_node_count(&((*root)->right));
+}
+
+
+// Get number of copies of data in a BST (in a tree built with insert(), the duplicates are spread over the left subtree)
+int get_count(node **root, int data) {
+    int copies = 0;
+    node *temp = *root;
+    while (temp != NULL) {
+        if (data == temp->data) copies += temp->count;
+        temp = (data <= temp->data) ? temp->left : temp->right;
+    }
+    return copies;
+}
+
+
+// Get rank of data in a BST: the number of elements smaller than data, counting every copy. Walks down the search
+// path and adds the sizes of the left subtrees it passes; nodes store no subtree sizes, so each of them is a walk too,
+// and one call is O(n), not O(height). Call it once per query, not in a loop over many keys
+int get_rank(node **root, int data) {
+    int rank = 0;
+    node *temp = *root;
+    while (temp != NULL) {
+        if (data <= temp->data) temp = temp->left;
+        else {
+            rank += get_size(&(temp->left)) + temp->count;
+            temp = temp->right;
+        }
+    }
+    return rank;
 }
 
 
@@ -146,15 +385,34 @@ bool is_balanced(node **root) {
 }
 
 
-// In-order traversal (depth-first)
+// In-order traversal (depth-first). Prints every copy of a multiset key
 void in_order(node **root) {
     if (*root == NULL) return; // Return when node is leaf (or when tree is empty)
     in_order(&((*root)->left));
-    printf("%d\n", (*root)->data);
+    for (int i = 0; i < (*root)->count; i++) printf("%d\n", (*root)->data);
     in_order(&((*root)->right));
 }
 
 
+// In-order traversal without recursion: the path of nodes whose right subtree is still to be visited is kept on an
+// sbo_stack, which stays in this stack frame for trees of height < SBO_STACK_N and moves to the heap only beyond
+void in_order_iterative(node **root) {
+    sbo_stack path;
+    sbo_stack_init(&path);
+    node *current = *root;
+    while (current != NULL || !sbo_stack_is_empty(&path)) {
+        while (current != NULL) { // Go down to the leftmost node, remembering the way back up
+            sbo_stack_push(&path, current);
+            current = current->left;
+        }
+        current = sbo_stack_pop(&path);
+        for (int i = 0; i < current->count; i++) printf("%d\n", current->data);
+        current = current->right;
+    }
+    sbo_stack_free(&path);
+}
+
+
 // Pre-order traversal (depth-first)
 void pre_order(node **root) {
     if (*root == NULL) return; // Return when node is leaf (or when tree is empty)
@@ -173,29 +431,32 @@ void post_order(node **root) {
 }
 
 
-// Breadth-first traversal (level order). Use queue to store node*
+// Breadth-first traversal (level order). The nodes of the current level and of the next one are kept in two sbo_stacks
+// read bottom up with sbo_stack_at(): a narrow tree needs no allocation, and unlike a fixed-size queue a wide level never runs out of room
 void level_order(node **root) {
     if (*root == NULL) return; // Return when tree is empty
-    
-    int arr_size = 20;
-    node* arr[arr_size];
-
-    node **parr = arr;
-    node ***pparr = &parr;
 
-    int front = -1; // front index of the queue, initially -1 to indicate an empty queue
-    int back = -1; // back index of the queue, initially -1 to indicate an empty queue
+    sbo_stack levels[2];
+    sbo_stack_init(&levels[0]);
+    sbo_stack_init(&levels[1]);
+    sbo_stack *level = &levels[0], *next_level = &levels[1];
+    sbo_stack_push(level, *root);
 
-    enqueue(pparr, arr_size, &front, &back, (*root)); // Enqueue root node of tree
-
-    // Run loop until all elements in queue are dequeued
-    while (!is_empty(&front, &back)) {
-        node *front_node = _front(pparr, &front); // Get node at front of queue
-        printf("%d\n", front_node->data); // Print data in front node
-        if (front_node->left != NULL) enqueue(pparr, arr_size, &front, &back, front_node->left); // Check if left subtree's root node is NULL. If not, push the node to queue
-        if (front_node->right != NULL) enqueue(pparr, arr_size, &front, &back, front_node->right); // Check if right subtree's root node is NULL. If not, push the node to queue
-        dequeue(pparr, arr_size, &front, &back);
+    // Run loop until a level has no nodes
+    while (!sbo_stack_is_empty(level)) {
+        for (int i = 0; i < sbo_stack_size(level); i++) {
+            node *n = sbo_stack_at(level, i);
+            printf("%d\n", n->data);
+            if (n->left != NULL) sbo_stack_push(next_level, n->left); // Children go to the next level, left to right
+            if (n->right != NULL) sbo_stack_push(next_level, n->right);
+        }
+        sbo_stack_clear(level);
+        sbo_stack *swap = level;
+        level = next_level;
+        next_level = swap;
     }
+    sbo_stack_free(&levels[0]);
+    sbo_stack_free(&levels[1]);
 }
 
 
@@ -222,7 +483,522 @@ bool is_BST(node **root) {
 
 
 
-int main() {
+// Copy a binary tree into nodes[] in pre-order, starting at index *next. Returns the index of its root node.
+// The snapshot format has no counts, so the extra copies of a multiset key are written as a chain of left children
+// with the same data, the layout insert() would have given them
+uint32_t freeze(node **root, snapshot_tnode *nodes, uint32_t *next) {
+    if (*root == NULL) return SNAPSHOT_NIL;
+    uint32_t i = (*next)++;
+    nodes[i].data = (*root)->data;
+    uint32_t last = i;
+    for (int c = 1; c < (*root)->count; c++) {
+        uint32_t copy = (*next)++;
+        nodes[copy].data = (*root)->data;
+        nodes[copy].right = SNAPSHOT_NIL;
+        nodes[last].left = copy;
+        last = copy;
+    }
+    nodes[last].left = freeze(&((*root)->left), nodes, next);
+    nodes[i].right = freeze(&((*root)->right), nodes, next);
+    return i;
+}
+
+
+// Save binary tree to a snapshot file. Returns true on success
+bool save_bst(node **root, const char *path) {
+    uint32_t count = get_size(root);
+    snapshot_tnode *nodes = (snapshot_tnode*)malloc(sizeof(snapshot_tnode) * (count > 0 ? count : 1));
+    uint32_t next = 0;
+    uint32_t root_index = freeze(root, nodes, &next);
+    bool ok = snapshot_write(path, SNAPSHOT_BST, root_index, nodes, count, sizeof(snapshot_tnode));
+    free(nodes);
+    return ok;
+}
+
+
+// Build a balanced BST from the sorted elements sorted[lo..hi] and attach it at *root (which must be NULL)
+void build_balanced(node **root, int *sorted, long lo, long hi) {
+    if (lo > hi) return;
+    long mid = lo + (hi - lo) / 2;
+    // Duplicates of the middle element must all end up in the left subtree (see insert()), so move mid to the last of them
+    while (mid < hi && sorted[mid + 1] == sorted[mid]) mid++;
+    create(root, sorted[mid]);
+    build_balanced(&((*root)->left), sorted, lo, mid - 1);
+    build_balanced(&((*root)->right), sorted, mid + 1, hi);
+}
+
+
+// Build a balanced multiset BST from the sorted keys[lo..hi] (all distinct), where counts[i] is the number of copies of keys[i]
+void build_balanced_counts(node **root, int *keys, int *counts, long lo, long hi) {
+    if (lo > hi) return;
+    long mid = lo + (hi - lo) / 2;
+    create(root, keys[mid]);
+    (*root)->count = counts[mid];
+    build_balanced_counts(&((*root)->left), keys, counts, lo, mid - 1);
+    build_balanced_counts(&((*root)->right), keys, counts, mid + 1, hi);
+}
+
+
+// Build a balanced multiset BST from n sorted elements, with one node per distinct key, and attach it at *root
+// (which must be NULL). The distinct keys are moved to the front of sorted[]
+void build_balanced_multiset(node **root, int *sorted, long n) {
+    int *counts = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+    long distinct = 0;
+    for (long i = 0; i < n; i++) {
+        if (distinct > 0 && sorted[distinct - 1] == sorted[i]) counts[distinct - 1]++;
+        else {
+            sorted[distinct] = sorted[i];
+            counts[distinct++] = 1;
+        }
+    }
+    build_balanced_counts(root, sorted, counts, 0, distinct - 1);
+    free(counts);
+}
+
+
+// Growable array that bulk-loaded data is collected into before building the BST
+typedef struct int_array {
+    int *data;
+    long size;
+    long capacity;
+} int_array;
+
+
+// Append a batch of bulk-loaded data to the int_array passed as ctx
+void load_batch(int *batch, int count, void *ctx) {
+    int_array *a = (int_array*)ctx;
+    if (a->size + count > a->capacity) {
+        while (a->size + count > a->capacity) a->capacity = a->capacity > 0 ? a->capacity * 2 : BULK_LOAD_BATCH_SIZE;
+        a->data = (int*)realloc(a->data, sizeof(int) * a->capacity);
+    }
+    memcpy(a->data + a->size, batch, sizeof(int) * count);
+    a->size += count;
+}
+
+
+// Compare function for qsort() on ints
+int compare_ints(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+
+// Add the keys of a BST to the roaring bitmap r (initialized by the caller). In-order, so that every key is
+// appended at the end of its container
+void bst_to_roaring(node **root, roaring *r) {
+    node *temp = *root;
+    while (temp != NULL) {
+        bst_to_roaring(&(temp->left), r);
+        roaring_add(r, temp->data);
+        temp = temp->right; // loop instead of recursing on the right subtree
+    }
+}
+
+
+// Append one value of a roaring bitmap to the int_array passed as ctx
+void collect_value(int value, void *ctx) {
+    load_batch(&value, 1, ctx);
+}
+
+// Build a balanced BST from the values of the roaring bitmap r and attach it at *root (which must be NULL).
+// The values come out sorted and distinct, so there is no need to sort them
+void roaring_to_bst(roaring *r, node **root) {
+    int_array a = {NULL, 0, 0};
+    roaring_iterate(r, collect_value, &a);
+    build_balanced(root, a.data, 0, a.size - 1);
+    free(a.data);
+}
+
+
+
+// Free all nodes of a binary tree one by one, giving them back to bst_allocator. This is O(n) and chases a ptr per
+// node, so trees whose nodes come from an arena should use destroy_arena_tree() instead
+void free_tree(node **root) {
+    while (*root != NULL) {
+        free_tree(&((*root)->left));
+        node *right = (*root)->right;
+        ds_free(bst_allocator, *root, sizeof(node));
+        *root = right; // loop instead of recursing on the right subtree
+    }
+}
+
+
+// Destroy a tree whose nodes come from arena in O(1), without visiting any node. This drops everything allocated
+// from the arena, so all trees built in it are destroyed together. The arena keeps its chunks for the next tree
+void destroy_arena_tree(node **root, arena_allocator *arena) {
+    arena_reset(arena);
+    *root = NULL;
+}
+
+
+// Node layouts that compact_tree() can produce
+typedef enum compact_order {
+    COMPACT_IN_ORDER, // in-order traversals (and range scans) walk memory sequentially
+    COMPACT_BFS       // the top levels of the tree, visited by every search, sit next to each other
+} compact_order;
+
+
+// Copy a binary tree into nodes allocated from to, in in-order sequence. Returns the root of the copy
+node* copy_in_order(node **root, allocator *to) {
+    if (*root == NULL) return NULL;
+    node *left = copy_in_order(&((*root)->left), to);
+    node *copy = (node*)ds_alloc(to, sizeof(node)); // allocated after the whole left subtree, before the right one
+    copy->data = (*root)->data;
+    copy->count = (*root)->count;
+    copy->left = left;
+    copy->right = copy_in_order(&((*root)->right), to);
+    return copy;
+}
+
+
+// Copy a binary tree into nodes allocated from to, in level order. Returns the root of the copy
+node* copy_bfs(node **root, allocator *to) {
+    if (*root == NULL) return NULL;
+    int size = get_node_count(root);
+    // Original nodes in level order. The array is its own queue: children are appended at the back while we
+    // walk it from the front
+    node **originals = (node**)malloc(sizeof(node*) * size);
+    node **copies = (node**)malloc(sizeof(node*) * size);
+    int back = 0;
+    originals[back++] = *root;
+    for (int front = 0; front < size; front++) {
+        copies[front] = (node*)ds_alloc(to, sizeof(node));
+        copies[front]->data = originals[front]->data;
+        copies[front]->count = originals[front]->count;
+        if (originals[front]->left != NULL) originals[back++] = originals[front]->left;
+        if (originals[front]->right != NULL) originals[back++] = originals[front]->right;
+    }
+    // The children of the nodes, taken in level order, are exactly the nodes after the root, in level order
+    int next = 1;
+    for (int i = 0; i < size; i++) {
+        copies[i]->left = (originals[i]->left != NULL) ? copies[next++] : NULL;
+        copies[i]->right = (originals[i]->right != NULL) ? copies[next++] : NULL;
+    }
+    node *new_root = copies[0];
+    free(originals);
+    free(copies);
+    return new_root;
+}
+
+
+// Relocate the tree at *root into new nodes from allocator to (usually a fresh arena), laid out in the given order,
+// and point *root at the copy. Returns the old root, whose nodes are left untouched: the caller frees them with
+// free_tree() or destroy_arena_tree(), depending on where they came from
+node* compact_tree(node **root, allocator *to, compact_order order) {
+    node *old_root = *root;
+    *root = (order == COMPACT_IN_ORDER) ? copy_in_order(root, to) : copy_bfs(root, to);
+    return old_root;
+}
+
+
+// Sum all data in a binary tree with an in-order traversal
+long long sum_in_order(node **root) {
+    if (*root == NULL) return 0;
+    return sum_in_order(&((*root)->left)) + (long long)(*root)->data * (*root)->count + sum_in_order(&((*root)->right));
+}
+
+
+// Sum all data in a binary tree with an iterative in-order traversal (see in_order_iterative()). Sets *spilled to
+// whether the scratch stack outgrew its inline buffer, i.e. had to allocate
+long long sum_in_order_iterative(node **root, bool *spilled) {
+    sbo_stack path;
+    sbo_stack_init(&path);
+    long long sum = 0;
+    node *current = *root;
+    while (current != NULL || !sbo_stack_is_empty(&path)) {
+        while (current != NULL) {
+            sbo_stack_push(&path, current);
+            current = current->left;
+        }
+        current = sbo_stack_pop(&path);
+        sum += (long long)current->data * current->count;
+        current = current->right;
+    }
+    *spilled = sbo_stack_on_heap(&path);
+    sbo_stack_free(&path);
+    return sum;
+}
+
+
+// Compare a BST built with insert() and a multiset BST built with insert_multiset(), from n random keys that take
+// only distinct different values, i.e. that repeat heavily
+void compare_multiset(int n, int distinct) {
+    allocator *saved_allocator = bst_allocator;
+    tracking_allocator plain_tracker, multiset_tracker;
+    tracking_init(&plain_tracker, NULL);
+    tracking_init(&multiset_tracker, NULL);
+    node *plain_root = NULL, *multiset_root = NULL;
+    unsigned int state = 88172645u;
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5; // xorshift32
+        int key = (int)(state % (unsigned int)distinct);
+        bst_allocator = &plain_tracker.base;
+        insert(&plain_root, key);
+        bst_allocator = &multiset_tracker.base;
+        insert_multiset(&multiset_root, key);
+    }
+
+    printf("\n%d inserts of %d distinct keys\n", n, distinct);
+    printf("insert():          size %d, %d nodes, height %d, rank of %d: %d, copies of it: %d\n", get_size(&plain_root),
+           get_node_count(&plain_root), get_height(&plain_root), distinct / 2, get_rank(&plain_root, distinct / 2), get_count(&plain_root, distinct / 2));
+    printf("insert_multiset(): size %d, %d nodes, height %d, rank of %d: %d, copies of it: %d\n", get_size(&multiset_root),
+           get_node_count(&multiset_root), get_height(&multiset_root), distinct / 2, get_rank(&multiset_root, distinct / 2), get_count(&multiset_root, distinct / 2));
+    tracking_report(&plain_tracker, "insert()", get_size(&plain_root));
+    tracking_report(&multiset_tracker, "insert_multiset()", get_size(&multiset_root));
+
+    bst_allocator = &plain_tracker.base;
+    free_tree(&plain_root);
+    bst_allocator = &multiset_tracker.base;
+    free_tree(&multiset_root);
+    bst_allocator = saved_allocator;
+}
+
+
+// Benchmark: n distinct random keys, ops searches whose keys follow a Zipf distribution with the given skew (the key
+// of rank k is searched with probability proportional to 1/k^skew). Compares a plain BST (random insertion order),
+// a balanced BST (build_balanced()) and a splay tree (same insertion order as the plain BST)
+void compare_splay(int n, int ops, double skew) {
+    allocator *saved_allocator = bst_allocator;
+    bst_allocator = NULL;
+    unsigned long long state = 88172645463325252ull;
+    int *keys = (int*)malloc(sizeof(int) * n);   // in insertion order
+    int *sorted = (int*)malloc(sizeof(int) * n);
+    int *by_rank = (int*)malloc(sizeof(int) * n); // by_rank[k] is the key of Zipf rank k
+    for (int i = 0; i < n; i++) keys[i] = (int)((unsigned int)i * 2654435761u >> 1); // distinct, scattered over the ints
+    for (int i = n - 1; i > 0; i--) { // shuffle the insertion order
+        int j = (int)(next_uniform(&state) * (i + 1));
+        int temp = keys[i]; keys[i] = keys[j]; keys[j] = temp;
+    }
+    memcpy(sorted, keys, sizeof(int) * n);
+    qsort(sorted, n, sizeof(int), compare_ints);
+    memcpy(by_rank, keys, sizeof(int) * n);
+    for (int i = n - 1; i > 0; i--) { // independent shuffle, so hot keys are not the first ones inserted
+        int j = (int)(next_uniform(&state) * (i + 1));
+        int temp = by_rank[i]; by_rank[i] = by_rank[j]; by_rank[j] = temp;
+    }
+
+    double *cdf = zipf_cdf(n, skew);
+    int *workload = (int*)malloc(sizeof(int) * ops);
+    for (int i = 0; i < ops; i++) workload[i] = by_rank[next_zipf(cdf, n, &state)];
+
+    node *plain_root = NULL, *balanced_root = NULL, *splay_root = NULL;
+    for (int i = 0; i < n; i++) insert(&plain_root, keys[i]);
+    build_balanced(&balanced_root, sorted, 0, n - 1);
+    for (int i = 0; i < n; i++) splay_insert(&splay_root, keys[i]);
+
+    printf("\n%d Zipf searches (skew %.2f) over %d keys\n", ops, skew, n);
+    const char *names[] = {"Plain BST", "Balanced BST", "Splay tree"};
+    node **roots[] = {&plain_root, &balanced_root, &splay_root};
+    for (int t = 0; t < 3; t++) {
+        ds_counters before = counters_snapshot();
+        clock_t start = clock();
+        int found = 0;
+        for (int i = 0; i < ops; i++) found += (t == 2) ? splay_search(roots[t], workload[i]) : search(roots[t], workload[i]);
+        double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+        ds_counters after = counters_snapshot();
+        printf("%-13s height %3d: %.3f s, %.1f M searches/s, found %d", names[t], get_height(roots[t]), secs, ops / secs / 1e6, found);
+        if (after.searches > before.searches) {
+            printf(", %.2f nodes visited per search", (double)(after.nodes_visited - before.nodes_visited) / (after.searches - before.searches));
+        }
+        printf("\n");
+    }
+
+    for (int t = 0; t < 3; t++) free_tree(roots[t]);
+    free(keys);
+    free(sorted);
+    free(by_rank);
+    free(cdf);
+    free(workload);
+    bst_allocator = saved_allocator;
+}
+
+
+// Benchmark: build a BST of n random keys, then search it for n keys of which only hit_percent% are in the tree,
+// without and with a Bloom filter (false positive rate fpr) in front of search()
+void compare_filter(int n, int hit_percent, double fpr) {
+    bloom filter;
+    bloom_init(&filter, NULL, n, fpr);
+    bloom *saved_filter = bst_filter;
+    bst_filter = &filter;
+    node *root = NULL;
+    unsigned int state = 2463534242u;
+    int *keys = (int*)malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5; // xorshift32
+        keys[i] = (int)(state & 0x7ffffffe); // even keys only, so that odd keys are misses
+        insert_multiset(&root, keys[i]);
+    }
+    int *queries = (int*)malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        queries[i] = keys[state % (unsigned int)n] + ((int)(state % 100) >= hit_percent);
+    }
+
+    double secs[2];
+    long found[2];
+    for (int with_filter = 0; with_filter < 2; with_filter++) {
+        bst_filter = with_filter ? &filter : NULL;
+        clock_t start = clock();
+        found[with_filter] = 0;
+        for (int i = 0; i < n; i++) found[with_filter] += search(&root, queries[i]);
+        secs[with_filter] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+    long false_positives = 0;
+    for (int i = 0; i < n; i++) false_positives += (queries[i] & 1) && bloom_maybe_contains(&filter, queries[i]);
+
+    printf("\n%d searches (%d%% hits) in a BST of %d keys (height %d)\n", n, hit_percent, n, get_height(&root));
+    printf("without filter: %.4f s (%ld found)\n", secs[0], found[0]);
+    printf("with filter:    %.4f s (%ld found), %d bits per key, k = %d, %zu bytes, false positive rate %.4f (target %.4f)\n",
+           secs[1], found[1], (int)(bloom_memory(&filter) * 8 / n), filter.k, bloom_memory(&filter),
+           (double)false_positives / (n - found[0] > 0 ? n - found[0] : 1), fpr);
+
+    bst_filter = saved_filter;
+    free_tree(&root);
+    bloom_free(&filter);
+    free(keys);
+    free(queries);
+}
+
+
+// Benchmark: in-order sums with recursion and with an sbo_stack, over a BST of n random keys (its height fits in the
+// inline buffer) and over a degenerate tree of depth n (a chain of left children, as after inserting sorted keys in
+// decreasing order), where the scratch stack moves to the heap. Recursion over the chain would need n stack frames,
+// enough to overflow the call stack, so only the iterative traversal is run on it
+void compare_traversal_scratch(int n) {
+    allocator *saved_allocator = bst_allocator;
+    bst_allocator = NULL;
+    node *root = NULL;
+    unsigned int state = 2463534242u;
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5; // xorshift32
+        insert_multiset(&root, (int)(state % (unsigned int)(4 * n)));
+    }
+    clock_t start = clock();
+    long long recursive_sum = 0;
+    for (int r = 0; r < 5; r++) recursive_sum += sum_in_order(&root);
+    double recursive_secs = (double)(clock() - start) / CLOCKS_PER_SEC / 5;
+    bool spilled = false;
+    start = clock();
+    long long iterative_sum = 0;
+    for (int r = 0; r < 5; r++) iterative_sum += sum_in_order_iterative(&root, &spilled);
+    double iterative_secs = (double)(clock() - start) / CLOCKS_PER_SEC / 5;
+    printf("\nIn-order sum of a random BST of %d keys (height %d, %d inline slots): recursive %.4f s, sbo_stack %.4f s, "
+           "sums %s, scratch stack on the heap: %s\n", n, get_height(&root), SBO_STACK_N, recursive_secs, iterative_secs,
+           recursive_sum == iterative_sum ? "equal" : "DIFFERENT", spilled ? "yes" : "no");
+    free_tree(&root);
+
+    // Chain of left children n-1, n-2, ..., 0. Built directly: inserting sorted keys one by one would take O(n^2)
+    create(&root, n - 1);
+    node *last = root;
+    for (int i = n - 2; i >= 0; i--) {
+        create(&last->left, i);
+        last = last->left;
+    }
+    start = clock();
+    iterative_sum = sum_in_order_iterative(&root, &spilled);
+    iterative_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("In-order sum of a chain of depth %d: sbo_stack %.4f s, sum %s, scratch stack on the heap: %s\n", n,
+           iterative_secs, iterative_sum == (long long)n * (n - 1) / 2 ? "correct" : "WRONG", spilled ? "yes" : "no");
+    while (root != NULL) { // free_tree() would recurse down the chain
+        node *left = root->left;
+        ds_free(bst_allocator, root, sizeof(node));
+        root = left;
+    }
+    bst_allocator = saved_allocator;
+}
+
+
+// Benchmark: build a BST of n random keys with malloc() and in an arena, then compare in-order traversals and
+// searches on the arena tree (nodes in insertion order) and on its in-order and BFS compacted copies, and the
+// time to destroy the malloc() tree node by node vs the arena tree at once
+void compare_arena_layouts(int n) {
+    allocator *saved_allocator = bst_allocator;
+    int *keys = (int*)malloc(sizeof(int) * n);
+    unsigned int state = 2463534242u;
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5; // xorshift32
+        keys[i] = (int)(state % (unsigned int)(4 * n));
+    }
+    arena_allocator insertion_arena, compact_arena;
+    arena_init(&insertion_arena, 0);
+    arena_init(&compact_arena, 0);
+
+    // Build the same tree with malloc() and in an arena
+    node *malloc_root = NULL, *arena_root = NULL;
+    bst_allocator = NULL;
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) insert(&malloc_root, keys[i]);
+    double malloc_build_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    bst_allocator = &insertion_arena.base;
+    start = clock();
+    for (int i = 0; i < n; i++) insert(&arena_root, keys[i]);
+    double arena_build_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("\nBuilding a BST of %d random keys: malloc %.3f s, arena %.3f s\n", n, malloc_build_secs, arena_build_secs);
+
+    // Traverse and search with the nodes in insertion order, then after each compaction
+    const char *layouts[] = {"insertion order", "in-order compacted", "BFS compacted"};
+    for (int layout = 0; layout < 3; layout++) {
+        if (layout > 0) {
+            // Copy into the other arena, then drop the old nodes at once and make the copy the tree to compact next
+            node *old_root = compact_tree(&arena_root, &compact_arena.base, layout == 1 ? COMPACT_IN_ORDER : COMPACT_BFS);
+            destroy_arena_tree(&old_root, &insertion_arena);
+            arena_allocator swap = insertion_arena;
+            insertion_arena = compact_arena;
+            compact_arena = swap;
+        }
+        start = clock();
+        long long sum = 0;
+        for (int r = 0; r < 5; r++) sum += sum_in_order(&arena_root);
+        double traverse_secs = (double)(clock() - start) / CLOCKS_PER_SEC / 5;
+        start = clock();
+        int found = 0;
+        for (int i = 0; i < n; i++) found += search(&arena_root, keys[(i * 7919L) % n] + (i & 1));
+        double search_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+        printf("Arena tree, %-19s in-order traversal %.4f s, %d searches %.3f s (sum %lld, found %d)\n",
+               layouts[layout], traverse_secs, n, search_secs, sum / 5, found);
+    }
+
+    // Destroy both trees
+    bst_allocator = NULL;
+    start = clock();
+    free_tree(&malloc_root);
+    double free_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    destroy_arena_tree(&arena_root, &insertion_arena);
+    double destroy_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("Destroying the tree: free_tree() %.4f s, destroy_arena_tree() %.6f s\n", free_secs, destroy_secs);
+
+    arena_release(&insertion_arena);
+    arena_release(&compact_arena);
+    free(keys);
+    bst_allocator = saved_allocator;
+}
+
+
+
+int main(int argc, char *argv[]) {
+    // Allocate the nodes through a tracking allocator, to see how much memory the tree uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    bst_allocator = &tracker.base;
+
+    bool bench = argc > 1 && strcmp(argv[1], "--bench") == 0;
+    if (argc > 1 && !bench) {
+        // Bulk load from a file ("-" for stdin): sort everything once, then build a balanced multiset BST
+        int_array a = {NULL, 0, 0};
+        long loaded = bulk_load(argv[1], load_batch, &a);
+        qsort(a.data, a.size, sizeof(int), compare_ints);
+        node *loaded_root = NULL;
+        build_balanced_multiset(&loaded_root, a.data, a.size);
+        free(a.data);
+        printf("Loaded %ld elements. Size of tree: %d in %d nodes, height of tree: %d, is BST: %d\n", loaded,
+               get_size(&loaded_root), get_node_count(&loaded_root), get_height(&loaded_root), is_BST(&loaded_root));
+        tracking_report(&tracker, "BST", get_size(&loaded_root));
+        free_tree(&loaded_root);
+        counters_print();
+        return loaded < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     // int arr_size = 20;
     // int arr[arr_size];
 
@@ -255,6 +1031,9 @@ int main() {
     printf("In-order traversal:\n");
     in_order(&root);
 
+    printf("In-order traversal without recursion:\n");
+    in_order_iterative(&root);
+
     printf("Pre-order traversal:\n");
     pre_order(&root);
 
@@ -266,5 +1045,47 @@ int main() {
 
     printf("Is BST?: %d\n", is_BST(&root));
 
+    // Filter set on a tree that already has keys: bst_set_filter() adds them, so none of them is rejected
+    bloom filter;
+    bloom_init(&filter, &tracker.base, 64, 0.01);
+    bst_set_filter(&root, &filter);
+    printf("With a Bloom filter: is 20 in the tree? %d. Is 21? %d\n", search(&root, 20), search(&root, 21));
+
+    // Save the tree, then map the snapshot and search it in place, without rebuilding any node
+    if (save_bst(&root, "bst_snapshot.bin")) {
+        snapshot snap;
+        if (snapshot_open(&snap, "bst_snapshot.bin", SNAPSHOT_BST, true)) {
+            printf("Snapshot has %u nodes. Is 20 in it? %d. Is 21 in it? %d\n", snap.header->count,
+                   snapshot_bst_search(&snap, 20), snapshot_bst_search(&snap, 21));
+            snapshot_close(&snap);
+        }
+        remove("bst_snapshot.bin");
+    }
+    tracking_report(&tracker, "BST", get_size(&root));
+
+    // Round trip through a roaring bitmap: the rebuilt tree is balanced
+    roaring set;
+    roaring_init(&set, NULL);
+    bst_to_roaring(&root, &set);
+    printf("As a roaring bitmap: %ld values in %zu bytes\n", roaring_cardinality(&set), roaring_memory(&set));
+    free_tree(&root);
+    roaring_to_bst(&set, &root);
+    roaring_free(&set);
+    printf("Rebuilt from the roaring bitmap: size %d, height %d, is BST: %d\n", get_size(&root), get_height(&root), is_BST(&root));
+
+    free_tree(&root);
+    bst_set_filter(&root, NULL);
+    bloom_free(&filter);
+    tracking_report(&tracker, "BST after free_tree()", 0);
+    counters_print();
+
+    if (bench) {
+        compare_multiset(1 << 16, 256);
+        compare_splay(1 << 18, 1 << 20, 1.1);
+        compare_arena_layouts(1 << 19);
+        compare_filter(1 << 20, 10, 0.01);
+        compare_traversal_scratch(1 << 20);
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,163 @@
+/*
+Blocking bounded queue - for producer and consumer threads
+
+queue.c and queueLL.c are queues for a single thread: a consumer running in another thread can only poll
+is_empty() until an item shows up, burning a whole core while the queue is idle, and a producer can only
+drop items when the array is full. A blocking queue makes the waiting part of the queue: pop waits while the
+queue is empty and push waits while it is full (which also slows fast producers down to the speed of the
+consumers: backpressure). Waiting first spins briefly, then sleeps on a condition variable, so an idle
+consumer uses no CPU, while a busy one does not pay a sleep/wake-up round trip for every item.
+
+The queue itself is implemented in the header file blocking_queue.h, so that other source files can include it.
+It holds ptrs (void*); here small ints are stored directly in the ptrs.
+
+Compile with: gcc -std=c11 -O2 -pthread blocking_queue.c
+
+---IMPLEMENTED OPERATIONS---
+
+1. Push, waiting while the queue is full (bqueue_push)
+2. Pop, waiting while the queue is empty (bqueue_pop), or at most a timeout (bqueue_pop_for)
+3. Push and pop many items under one lock, with one wake-up for all waiting threads (bqueue_push_batch, bqueue_pop_batch)
+4. Close: later pushes fail, consumers drain what is left, then get BQUEUE_CLOSED (bqueue_close)
+5. Number of items (bqueue_size)
+
+Below:
+6. CPU used by an idle consumer: blocking pop vs polling is_empty() (see main())
+7. Producer/consumer threads, item by item and in batches, with the number of waits that spun or slept
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "blocking_queue.h"
+
+// Work of one producer or consumer thread
+typedef struct worker {
+    bqueue *q;
+    int items;      // producer: number of items to push
+    int batch;      // items per push/pop call
+    long long sum;  // consumer: sum of the items popped
+    long popped;
+} worker;
+
+
+// Wall-clock time in seconds
+double wall_time() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Producer thread: push the ints 1..items, batch items per call
+void* producer(void *arg) {
+    worker *w = (worker*)arg;
+    void *batch[256];
+    for (int i = 1; i <= w->items; i += w->batch) {
+        int n = 0;
+        for (int j = i; j < i + w->batch && j <= w->items; j++) batch[n++] = (void*)(intptr_t)j;
+        if (bqueue_push_batch(w->q, batch, n) < n) break; // closed
+    }
+    return NULL;
+}
+
+
+// Consumer thread: pop until the queue is closed and drained, batch items per call
+void* consumer(void *arg) {
+    worker *w = (worker*)arg;
+    void *batch[256];
+    int popped;
+    while (bqueue_pop_batch(w->q, batch, w->batch, &popped, -1) == BQUEUE_OK) {
+        for (int i = 0; i < popped; i++) w->sum += (intptr_t)batch[i];
+        w->popped += popped;
+    }
+    return NULL;
+}
+
+
+// Run producers and consumers threads over a queue of the given capacity, each pushing items ints, batch per call
+void run_threads(int producers, int consumers, int items, int capacity, int batch) {
+    bqueue q;
+    bqueue_init(&q, capacity);
+    pthread_t threads[16];
+    worker workers[16] = {{0}};
+    double start = wall_time();
+    for (int i = 0; i < producers + consumers; i++) {
+        workers[i].q = &q;
+        workers[i].items = items;
+        workers[i].batch = batch;
+        pthread_create(&threads[i], NULL, (i < producers) ? producer : consumer, &workers[i]);
+    }
+    for (int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+    bqueue_close(&q); // all items are in: consumers stop once the queue is drained
+    long long sum = 0;
+    long popped = 0;
+    for (int i = producers; i < producers + consumers; i++) {
+        pthread_join(threads[i], NULL);
+        sum += workers[i].sum;
+        popped += workers[i].popped;
+    }
+    double secs = wall_time() - start;
+    long long expected = (long long)producers * items * (items + 1LL) / 2;
+    printf("%d producers, %d consumers, batch %3d: %ld items in %.3f s (%.1f M items/s), sum %s, %ld waits slept, %ld spun\n",
+           producers, consumers, batch, popped, secs, popped / secs / 1e6, sum == expected ? "correct" : "WRONG",
+           atomic_load(&q.parks), atomic_load(&q.spin_hits));
+    bqueue_destroy(&q);
+}
+
+
+// CPU time used while a consumer waits ms milliseconds on an empty queue: blocking pop vs polling the size
+void compare_idle(long ms) {
+    bqueue q;
+    bqueue_init(&q, 16);
+    void *item;
+
+    clock_t start = clock(); // CPU time of the process
+    bqueue_status status = bqueue_pop_for(&q, &item, ms);
+    double blocking_cpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    double end = wall_time() + ms / 1000.0;
+    while (bqueue_size(&q) == 0 && wall_time() < end) ; // what a consumer of queue.c has to do: poll is_empty()
+    double polling_cpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("Idle consumer for %ld ms: bqueue_pop_for() used %.4f s of CPU (%s), polling used %.4f s\n",
+           ms, blocking_cpu, status == BQUEUE_TIMEOUT ? "timed out" : "?", polling_cpu);
+    bqueue_destroy(&q);
+}
+
+
+
+int main() {
+    bqueue q;
+    bqueue_init(&q, 5); // room for the user's (at most 4) ints plus 42, since nothing pops until the queue is closed
+
+    int n, x;
+    printf("Enter the number of ints to push (at most 4): ");
+    scanf("%d", &n);
+    for (int i=0; i<n && i<4; i++) {
+        printf("Enter int to push: ");
+        scanf("%d", &x);
+        bqueue_push(&q, (void*)(intptr_t)x);
+    }
+    bqueue_push(&q, (void*)(intptr_t)42);
+    bqueue_close(&q);
+    printf("\nPush after close: %s\n", bqueue_push(&q, (void*)(intptr_t)7) ? "accepted" : "rejected");
+    void *item;
+    printf("Draining the closed queue:");
+    while (bqueue_pop(&q, &item) == BQUEUE_OK) printf(" %d", (int)(intptr_t)item);
+    printf(" (then BQUEUE_CLOSED)\n");
+    bqueue_destroy(&q);
+
+    compare_idle(200);
+    printf("\n");
+    run_threads(1, 1, 1 << 20, 1024, 1);
+    run_threads(1, 1, 1 << 20, 1024, 64);
+    run_threads(2, 2, 1 << 19, 1024, 1);
+    run_threads(2, 2, 1 << 19, 1024, 64);
+
+    return EXIT_SUCCESS;
+}
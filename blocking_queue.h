@@ -0,0 +1,251 @@
+// This header file contains a blocking bounded queue of ptrs (void*) for passing work between threads, defined here
+// so that other .c source files can include it. blocking_queue.c demonstrates it with producer and consumer threads.
+//
+// With queue.c or queueLL.c, a consumer that finds the queue empty can only call is_empty() again and again, which
+// keeps a core at 100% while there is nothing to do, and a producer that finds it full has to drop the item or poll.
+// Here a consumer that finds the queue empty (or a producer that finds it full) waits:
+// 1. First it spins for a short while, re-reading the item count without taking the lock. Under load, the next item
+//    usually arrives within a few hundred nanoseconds, much sooner than a sleeping thread could be woken up again.
+//    The spin length adapts: it doubles when spinning paid off and halves when it did not, so an idle queue quickly
+//    stops spinning. On a machine with a single CPU, spinning can never pay off (the thread we wait for cannot run
+//    while we spin), so it is switched off.
+// 2. Then it parks: it sleeps on a condition variable, using no CPU at all, until another thread signals it.
+// Signals are only sent when some thread is actually parked (the queue counts them), so under load, when nobody
+// sleeps, pushes and pops make no wake-up system calls. A batch push or pop wakes all parked threads at once instead
+// of one per item.
+//
+// Closing the queue (bqueue_close()) makes every later push fail, and wakes all waiting threads. Consumers keep
+// getting the items that are still in the queue (drain), and get BQUEUE_CLOSED once it is empty. This gives an
+// orderly shutdown: producers close the queue when they are done, and consumers stop after the last item.
+//
+// Compile with -pthread.
+
+
+#ifndef BLOCKING_QUEUE_H
+#define BLOCKING_QUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define BQUEUE_MIN_SPIN 16     // spin iterations are never reduced below this (unless spinning is off)
+#define BQUEUE_MAX_SPIN 4096
+
+typedef enum bqueue_status {
+    BQUEUE_OK,
+    BQUEUE_TIMEOUT, // nothing arrived before the timeout
+    BQUEUE_CLOSED   // the queue is closed and empty
+} bqueue_status;
+
+typedef struct bqueue {
+    void **items;          // circular array of capacity items
+    int capacity;
+    int head;              // index of the oldest item
+    atomic_int count;      // number of items. Changed only under the lock, but read without it while spinning
+    atomic_bool closed;
+    int waiting_consumers; // threads parked on not_empty / not_full (under the lock)
+    int waiting_producers;
+    atomic_int spin_limit; // current spin length
+    int max_spin;          // 0 on a single CPU
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    atomic_long parks;     // statistics: waits that had to sleep, and waits that ended while spinning
+    atomic_long spin_hits;
+} bqueue;
+
+
+
+// Initialize an empty queue that holds up to capacity items
+void bqueue_init(bqueue *q, int capacity) {
+    if (capacity < 1) capacity = 1;
+    q->items = (void**)malloc(sizeof(void*) * capacity);
+    q->capacity = capacity;
+    q->head = 0;
+    atomic_init(&q->count, 0);
+    atomic_init(&q->closed, false);
+    q->waiting_consumers = 0;
+    q->waiting_producers = 0;
+    q->max_spin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? BQUEUE_MAX_SPIN : 0;
+    atomic_init(&q->spin_limit, q->max_spin > 0 ? BQUEUE_MIN_SPIN * 4 : 0);
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    atomic_init(&q->parks, 0);
+    atomic_init(&q->spin_hits, 0);
+}
+
+
+// Free the queue. No thread may be using it any more
+void bqueue_destroy(bqueue *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->items);
+    q->items = NULL;
+}
+
+
+// Number of items in the queue (may be outdated as soon as it returns, if other threads use the queue)
+int bqueue_size(bqueue *q) {
+    return atomic_load(&q->count);
+}
+
+
+// Close the queue: later pushes fail, and consumers get BQUEUE_CLOSED once the queue is empty. Wakes all waiting threads
+void bqueue_close(bqueue *q) {
+    pthread_mutex_lock(&q->lock);
+    atomic_store(&q->closed, true);
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+}
+
+
+// Tell the CPU we are in a spin loop (lets the other hyperthread of the core run, and saves power)
+void bqueue_cpu_relax() {
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+
+// Return true if a consumer (want_items) or producer (!want_items) would not have to wait now
+bool bqueue_ready(bqueue *q, bool want_items) {
+    if (atomic_load_explicit(&q->closed, memory_order_relaxed)) return true;
+    int count = atomic_load_explicit(&q->count, memory_order_relaxed);
+    return want_items ? count > 0 : count < q->capacity;
+}
+
+
+// Spin without the lock until the queue is ready, for at most spin_limit iterations, and adapt spin_limit.
+// Returns true if the queue became ready. The caller still has to check again under the lock
+bool bqueue_spin(bqueue *q, bool want_items) {
+    int limit = atomic_load_explicit(&q->spin_limit, memory_order_relaxed);
+    for (int i = 0; i < limit; i++) {
+        if (bqueue_ready(q, want_items)) {
+            if (limit < q->max_spin) atomic_store_explicit(&q->spin_limit, limit * 2, memory_order_relaxed);
+            atomic_fetch_add_explicit(&q->spin_hits, 1, memory_order_relaxed);
+            return true;
+        }
+        bqueue_cpu_relax();
+    }
+    if (limit > BQUEUE_MIN_SPIN) atomic_store_explicit(&q->spin_limit, limit / 2, memory_order_relaxed);
+    return false;
+}
+
+
+// Park on cond until the queue is ready, or until deadline (NULL for no deadline). The lock must be held.
+// Returns false on timeout
+bool bqueue_park(bqueue *q, pthread_cond_t *cond, int *waiting, bool want_items, const struct timespec *deadline) {
+    while (!bqueue_ready(q, want_items)) {
+        (*waiting)++;
+        atomic_fetch_add_explicit(&q->parks, 1, memory_order_relaxed);
+        int rc = (deadline == NULL) ? pthread_cond_wait(cond, &q->lock) : pthread_cond_timedwait(cond, &q->lock, deadline);
+        (*waiting)--;
+        if (rc == ETIMEDOUT) return bqueue_ready(q, want_items);
+    }
+    return true;
+}
+
+
+// Push up to n items, waiting while the queue is full. Items are pushed in order, in as many parts as the free space
+// requires. Returns the number of items pushed, which is less than n only if the queue was closed
+int bqueue_push_batch(bqueue *q, void **items, int n) {
+    int pushed = 0;
+    while (pushed < n) {
+        if (!bqueue_ready(q, false)) bqueue_spin(q, false);
+        pthread_mutex_lock(&q->lock);
+        bqueue_park(q, &q->not_full, &q->waiting_producers, false, NULL);
+        if (atomic_load(&q->closed)) {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        int count = atomic_load_explicit(&q->count, memory_order_relaxed);
+        int m = n - pushed;
+        if (m > q->capacity - count) m = q->capacity - count;
+        for (int i = 0; i < m; i++) q->items[(q->head + count + i) % q->capacity] = items[pushed + i];
+        atomic_store_explicit(&q->count, count + m, memory_order_release);
+        if (q->waiting_consumers > 0) {
+            if (m == 1) pthread_cond_signal(&q->not_empty);
+            else pthread_cond_broadcast(&q->not_empty);
+        }
+        pthread_mutex_unlock(&q->lock);
+        pushed += m;
+    }
+    return pushed;
+}
+
+
+// Push one item, waiting while the queue is full. Returns false if the queue is closed
+bool bqueue_push(bqueue *q, void *item) {
+    return bqueue_push_batch(q, &item, 1) == 1;
+}
+
+
+// Pop between 1 and max items into items[], waiting at most timeout_ms milliseconds (-1: no limit, 0: do not wait)
+// while the queue is empty. Sets *popped to the number of items popped (0 unless BQUEUE_OK is returned)
+bqueue_status bqueue_pop_batch(bqueue *q, void **items, int max, int *popped, long timeout_ms) {
+    *popped = 0;
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        // pthread_cond_timedwait() takes an absolute time on the CLOCK_REALTIME clock (TIME_UTC)
+        timespec_get(&deadline, TIME_UTC);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+    if (timeout_ms != 0 && !bqueue_ready(q, true)) bqueue_spin(q, true);
+
+    pthread_mutex_lock(&q->lock);
+    bool ready = (timeout_ms == 0) ? bqueue_ready(q, true)
+               : bqueue_park(q, &q->not_empty, &q->waiting_consumers, true, timeout_ms > 0 ? &deadline : NULL);
+    if (!ready) {
+        pthread_mutex_unlock(&q->lock);
+        return BQUEUE_TIMEOUT;
+    }
+    int count = atomic_load_explicit(&q->count, memory_order_relaxed);
+    if (count == 0) { // ready with no items: closed and drained
+        pthread_mutex_unlock(&q->lock);
+        return BQUEUE_CLOSED;
+    }
+    int m = (count < max) ? count : max;
+    for (int i = 0; i < m; i++) items[i] = q->items[(q->head + i) % q->capacity];
+    q->head = (q->head + m) % q->capacity;
+    atomic_store_explicit(&q->count, count - m, memory_order_release);
+    if (q->waiting_producers > 0) {
+        if (m == 1) pthread_cond_signal(&q->not_full);
+        else pthread_cond_broadcast(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    *popped = m;
+    return BQUEUE_OK;
+}
+
+
+// Pop one item into *item, waiting while the queue is empty. Returns BQUEUE_OK, or BQUEUE_CLOSED once the queue
+// is closed and drained
+bqueue_status bqueue_pop(bqueue *q, void **item) {
+    int popped;
+    return bqueue_pop_batch(q, item, 1, &popped, -1);
+}
+
+
+// Pop one item into *item, waiting at most timeout_ms milliseconds while the queue is empty
+bqueue_status bqueue_pop_for(bqueue *q, void **item, long timeout_ms) {
+    int popped;
+    return bqueue_pop_batch(q, item, 1, &popped, timeout_ms);
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+Blocked Bloom filter - used in front of linear searches of linked lists and searches of BSTs
+
+search_data() in linked_list.c and doubly_linked_list.c walks the whole list before it can say that data is not
+there, and a BST search walks from the root down to a leaf. When most lookups are misses, nearly all that work
+only proves a negative. A Bloom filter proves most negatives in O(1), from a few bits per element, with one
+cache miss per lookup in the blocked layout of bloom.h. Only the keys it answers "maybe" for (the ones in the
+list plus a small fraction of false positives) still go through the search.
+
+The filter itself is implemented in the header file bloom.h, so that other source files can include it.
+linked_list.c (ll_filter), doubly_linked_list.c (node_filter, and per handle with dll_set_filter()) and
+binary_search_tree.c (bst_filter) maintain it on insert and consult it before searching.
+
+---IMPLEMENTED OPERATIONS---
+
+1. Create a filter for n keys with a chosen false positive rate (bloom_init)
+2. Add a key (bloom_add)
+3. Check a key: "certainly not" or "maybe" (bloom_maybe_contains)
+4. Clear the filter, e.g. to rebuild it after many deletes (bloom_clear)
+5. Fill ratio and memory used (bloom_fill_ratio, bloom_memory)
+
+Below, a linked list with a filter in front of its linear search:
+6. Measure the false positive rate against the target rate
+7. Compare the time of mostly missing lookups with and without the filter (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bloom.h"
+
+// Linked list node, as in linked_list.c
+typedef struct node {
+    int data;
+    struct node *next;
+} node;
+
+// Global variables that point to the first LL node, and to the filter of its data (NULL for none)
+node *head;
+bloom *filter;
+
+
+
+// Insert node at beginning of LL and add its data to the filter
+void insert_beg(int x) {
+    node *new_node = (node*)malloc(sizeof(node));
+    new_node->data = x;
+    new_node->next = head;
+    head = new_node;
+    bloom_add(filter, x);
+}
+
+
+// Linear search a linked list, as in linked_list.c, after asking the filter
+node* search_data(int data) {
+    if (!bloom_maybe_contains(filter, data)) return NULL;
+    node *temp = head;
+    while (temp != NULL && temp->data != data) temp = temp->next;
+    return temp;
+}
+
+
+// Free all nodes
+void free_list() {
+    while (head != NULL) {
+        node *next = head->next;
+        free(head);
+        head = next;
+    }
+}
+
+
+// Add n keys to a filter with false positive rate fpr, then check n keys that were not added
+void measure_fpr(int n, double fpr) {
+    bloom b;
+    bloom_init(&b, NULL, n, fpr);
+    for (int i = 0; i < n; i++) bloom_add(&b, 2 * i);
+    int false_positives = 0;
+    for (int i = 0; i < n; i++) false_positives += bloom_maybe_contains(&b, 2 * i + 1);
+    printf("Target rate %.4f: k = %d, %.1f bits per key, fill ratio %.2f, measured rate %.4f\n", fpr, b.k,
+           (double)bloom_memory(&b) * 8 / n, bloom_fill_ratio(&b), (double)false_positives / n);
+    bloom_free(&b);
+}
+
+
+// Time lookups of keys (only 1 in hit_every of them in the LL) through the plain linear search and with the filter
+void compare_lookups(int n, int lookups, int hit_every) {
+    bloom b;
+    bloom_init(&b, NULL, n, 0.01);
+    filter = &b;
+    for (int i = 0; i < n; i++) insert_beg(i);
+
+    int found[2];
+    double secs[2];
+    for (int with_filter = 0; with_filter < 2; with_filter++) {
+        filter = with_filter ? &b : NULL;
+        found[with_filter] = 0;
+        clock_t start = clock();
+        for (int i = 0; i < lookups; i++) {
+            int key = (i % hit_every == 0) ? i % n : n + i; // keys >= n are misses
+            found[with_filter] += (search_data(key) != NULL);
+        }
+        secs[with_filter] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+    printf("%d nodes, %d lookups (1 in %d a hit): linear search %.4fs (%d found), with filter %.4fs (%d found)\n",
+           n, lookups, hit_every, secs[0], found[0], secs[1], found[1]);
+    filter = NULL;
+    free_list();
+    bloom_free(&b);
+}
+
+
+
+int main() {
+    head = NULL;
+    bloom b;
+    bloom_init(&b, NULL, 1000, 0.01);
+    filter = &b;
+
+    int data_elements;
+    int x;
+    printf("Enter number of elements to add to LL: ");
+    scanf("%d", &data_elements);
+    for (int i=0; i<data_elements; i++) {
+        printf("Enter number to add: ");
+        scanf("%d", &x);
+        insert_beg(x);
+    }
+    insert_beg(42);
+    insert_beg(-7);
+    printf("\nIs 42 in the LL? %d. Is 43? %d (the filter says %s)\n", search_data(42) != NULL, search_data(43) != NULL,
+           bloom_maybe_contains(filter, 43) ? "maybe" : "certainly not");
+    filter = NULL;
+    free_list();
+    bloom_free(&b);
+
+    printf("\n");
+    for (double fpr = 0.1; fpr > 0.00005; fpr /= 10) measure_fpr(1 << 20, fpr);
+    printf("\n");
+    compare_lookups(10000, 10000, 10);
+    compare_lookups(10000, 10000, 100);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+// This header file contains a blocked Bloom filter for int keys, defined here so that other .c source files can
+// include it. linked_list.c, doubly_linked_list.c and binary_search_tree.c use it in front of their searches, and
+// bloom.c measures its false positive rate and what it saves on lookups of missing keys.
+//
+// A Bloom filter answers "is key in the set?" with either "certainly not" or "maybe". Adding a key sets k bits,
+// chosen by hashing the key; a lookup checks the same k bits, and if any of them is 0 the key was never added.
+// A key that was not added can still find all its k bits set by other keys: a false positive, whose rate is
+// chosen when the filter is created. There are no false negatives. So a search can ask the filter first and skip
+// the O(n) list scan or the root-to-leaf walk whenever the answer is "certainly not", which is the common case
+// when most lookups are misses.
+//
+// In a standard Bloom filter, the k bits are spread over the whole bit array, i.e. about k cache misses per lookup.
+// Here the bit array is split into blocks of 512 bits (one 64-byte cache line), the hash picks one block, and all
+// k bits of the key are in that block: one cache miss per lookup. The price is a slightly higher false positive
+// rate than a standard filter of the same size, because some blocks get more keys than others.
+//
+// Keys cannot be removed: clearing a key's bits could clear bits of other keys too, and cause false negatives.
+// When a structure deletes a key, its bits just stay set. That is still correct (the filter only answers "maybe"
+// more often), and bloom_clear() followed by adding the remaining keys brings the rate back down.
+//
+// Functions accept a NULL filter, meaning no filter: bloom_add() does nothing and bloom_maybe_contains() says
+// "maybe" for every key, so a structure can keep one optional filter ptr, like its allocator ptr.
+//
+// The bit array comes from the allocator passed to bloom_init() (NULL for aligned_alloc()/free(), see allocator.h),
+// so a tracking allocator can include the filter in the memory it reports for a structure.
+
+
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "counters.h"
+#include "allocator.h"
+
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_BLOCK_WORDS (BLOOM_BLOCK_BITS / 64)
+#define BLOOM_MAX_K 16
+
+typedef struct bloom {
+    uint64_t *blocks;    // num_blocks * BLOOM_BLOCK_WORDS words, aligned to a cache line
+    uint32_t num_blocks;
+    int k;               // bits set per key
+    long count;          // keys added (including repeated adds of the same key)
+    allocator *alloc;    // allocator of the bit array (NULL for aligned_alloc()/free())
+} bloom;
+
+
+// Mix the bits of x (splitmix64 finalizer)
+uint64_t bloom_mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+
+// Hash an int key into 64 bits
+uint64_t bloom_hash(int key) {
+    return bloom_mix((uint64_t)(uint32_t)key + 0x9e3779b97f4a7c15ull);
+}
+
+
+// log2(x) for x >= 1, without libm: integer part by halving, then one fraction bit per squaring
+double bloom_log2(double x) {
+    double result = 0;
+    while (x >= 2) {
+        x /= 2;
+        result += 1;
+    }
+    double bit = 0.5;
+    for (int i = 0; i < 30; i++) {
+        x *= x;
+        if (x >= 2) {
+            x /= 2;
+            result += bit;
+        }
+        bit /= 2;
+    }
+    return result;
+}
+
+
+// Create a filter for about expected_keys keys, with a false positive rate of about fpr (0 < fpr < 1).
+// The optimal standard Bloom filter uses log2(1/fpr) / ln(2) bits per key and k = log2(1/fpr) bits set per key.
+// The blocked layout gets 10% more bits, to make up for the uneven load of the blocks. The bit array comes from alloc
+void bloom_init(bloom *b, allocator *alloc, long expected_keys, double fpr) {
+    if (expected_keys < 1) expected_keys = 1;
+    if (fpr <= 0 || fpr >= 1) {
+        printf("Invalid false positive rate %g, using 0.01\n", fpr);
+        fpr = 0.01;
+    }
+    double bits_per_key = 1.1 * bloom_log2(1 / fpr) / 0.6931471805599453;
+    b->k = (int)(bloom_log2(1 / fpr) + 0.5);
+    if (b->k < 1) b->k = 1;
+    if (b->k > BLOOM_MAX_K) b->k = BLOOM_MAX_K;
+    double bits = bits_per_key * expected_keys;
+    b->num_blocks = (uint32_t)(bits / BLOOM_BLOCK_BITS) + 1;
+    size_t bytes = (size_t)b->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t); // a multiple of 64, as aligned_alloc() requires
+    b->alloc = alloc;
+    b->blocks = (uint64_t*)ds_alloc_aligned(alloc, 64, bytes);
+    memset(b->blocks, 0, bytes);
+    b->count = 0;
+}
+
+
+// Free the bit array
+void bloom_free(bloom *b) {
+    ds_free_aligned(b->alloc, b->blocks, 64, (size_t)b->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    b->blocks = NULL;
+    b->num_blocks = 0;
+    b->count = 0;
+}
+
+
+// Remove all keys
+void bloom_clear(bloom *b) {
+    memset(b->blocks, 0, (size_t)b->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    b->count = 0;
+}
+
+
+// Return the block of key, and set mask to the k bits of key inside that block
+uint64_t* bloom_block_mask(bloom *b, int key, uint64_t mask[BLOOM_BLOCK_WORDS]) {
+    uint64_t hash = bloom_hash(key);
+    // The upper 32 bits pick the block: multiply-shift maps them to [0, num_blocks) without a division
+    uint64_t *block = b->blocks + (size_t)(((hash >> 32) * b->num_blocks) >> 32) * BLOOM_BLOCK_WORDS;
+    // Every bit takes 9 fresh hash bits (a position in 0..511): 7 bits from every 64-bit hash, and the next hash
+    // comes from mixing the key's hash with a counter. Deriving the bits from just 2 values (double hashing) would
+    // give many keys the same k bits, and a floor under the false positive rate
+    memset(mask, 0, sizeof(uint64_t) * BLOOM_BLOCK_WORDS);
+    uint64_t bits = 0;
+    for (int i = 0; i < b->k; i++) {
+        if (i % 7 == 0) bits = bloom_mix(hash + (uint64_t)(i / 7 + 1) * 0x9e3779b97f4a7c15ull);
+        uint32_t bit = (uint32_t)(bits % BLOOM_BLOCK_BITS);
+        bits >>= 9;
+        mask[bit / 64] |= 1ull << (bit % 64);
+    }
+    return block;
+}
+
+
+// Add key to the filter (nothing if b is NULL)
+void bloom_add(bloom *b, int key) {
+    if (b == NULL) return;
+    uint64_t mask[BLOOM_BLOCK_WORDS];
+    uint64_t *block = bloom_block_mask(b, key, mask);
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) block[i] |= mask[i];
+    b->count++;
+}
+
+
+// Return false if key was certainly never added, true if it may have been (always true if b is NULL)
+bool bloom_maybe_contains(bloom *b, int key) {
+    if (b == NULL) return true;
+    uint64_t mask[BLOOM_BLOCK_WORDS];
+    uint64_t *block = bloom_block_mask(b, key, mask);
+    // Check all k bits at once, with no branch per bit: the compiler turns this into a few vector instructions
+    uint64_t missing = 0;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) missing |= mask[i] & ~block[i];
+    return missing == 0;
+}
+
+
+// Fraction of bits set. The false positive rate for a random missing key is about fill ratio ^ k
+double bloom_fill_ratio(bloom *b) {
+    long set = 0;
+    for (size_t i = 0; i < (size_t)b->num_blocks * BLOOM_BLOCK_WORDS; i++) set += __builtin_popcountll(b->blocks[i]);
+    return (double)set / ((double)b->num_blocks * BLOOM_BLOCK_BITS);
+}
+
+
+// Bytes used by the bit array
+size_t bloom_memory(bloom *b) {
+    return (size_t)b->num_blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+}
+
+#endif
@@ -0,0 +1,131 @@
+// This header file contains a fast bulk loader for ints, defined here so that every program in this
+// directory can include it and fill its container from a file (or stdin) instead of prompting for one
+// number at a time with printf() + scanf().
+//
+// scanf("%d") goes through format string parsing, locale handling and stream locking for every single
+// number. Instead, we read the input in large blocks (the whole file with mmap() for regular files, 1 MB
+// read() calls for pipes and stdin) and parse the digits ourselves in one pass over the bytes. Parsed
+// numbers are handed to a callback in batches of BULK_LOAD_BATCH_SIZE, so the container can insert a whole
+// batch at once (e.g. reserve room once, or walk to the end of a list once).
+//
+// Input format: decimal ints with an optional leading '-', separated by any non-digit characters
+// (spaces, newlines, commas, ...). Values outside the int range are not checked and wrap around.
+
+
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BULK_LOAD_BUFFER_SIZE (1 << 20)
+#define BULK_LOAD_BATCH_SIZE 4096
+
+// Called with every batch of parsed ints. ctx is passed through from bulk_load()
+typedef void (*bulk_load_fn)(int *batch, int count, void *ctx);
+
+// Parser state, kept across blocks so that a number can be split between two reads
+typedef struct bulk_parser {
+    int batch[BULK_LOAD_BATCH_SIZE];
+    int count;           // number of ints in batch
+    unsigned int value;  // digits of the current number so far
+    bool in_number;
+    bool negative;
+    bool minus_seen;     // last byte was a '-'
+    long total;          // number of ints parsed so far
+    bulk_load_fn fn;
+    void *ctx;
+} bulk_parser;
+
+
+// Hand the current batch to the callback
+void bulk_flush(bulk_parser *p) {
+    if (p->count > 0) p->fn(p->batch, p->count, p->ctx);
+    p->count = 0;
+}
+
+
+// Finish the current number and add it to the batch
+void bulk_end_number(bulk_parser *p) {
+    p->batch[p->count++] = p->negative ? (int)(0u - p->value) : (int)p->value;
+    p->total++;
+    p->in_number = false;
+    p->value = 0;
+    if (p->count == BULK_LOAD_BATCH_SIZE) bulk_flush(p);
+}
+
+
+// Parse one block of bytes
+void bulk_parse(bulk_parser *p, const char *bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned int digit = (unsigned char)bytes[i] - '0';
+        if (digit < 10) {
+            if (!p->in_number) {
+                p->in_number = true;
+                p->negative = p->minus_seen;
+            }
+            p->value = p->value * 10 + digit;
+            p->minus_seen = false;
+        }
+        else {
+            if (p->in_number) bulk_end_number(p);
+            p->minus_seen = (bytes[i] == '-');
+        }
+    }
+}
+
+
+// Read all ints from the file at path ("-" for stdin) and pass them in batches to fn(batch, count, ctx).
+// Returns the number of ints loaded, or -1 if the input cannot be read
+long bulk_load(const char *path, bulk_load_fn fn, void *ctx) {
+    bool from_stdin = strcmp(path, "-") == 0;
+    int fd = from_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open %s.\n", path);
+        return -1;
+    }
+
+    bulk_parser *p = (bulk_parser*)calloc(1, sizeof(bulk_parser));
+    p->fn = fn;
+    p->ctx = ctx;
+    long result = 0;
+
+    // Regular files: map the whole file and parse it in one pass
+    struct stat st;
+    bool mapped = false;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *bytes = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (bytes != MAP_FAILED) {
+            bulk_parse(p, (const char*)bytes, (size_t)st.st_size);
+            munmap(bytes, (size_t)st.st_size);
+            mapped = true;
+        }
+    }
+
+    // Pipes, stdin, or files that cannot be mapped: read large blocks
+    if (!mapped) {
+        char *buffer = (char*)malloc(BULK_LOAD_BUFFER_SIZE);
+        ssize_t n;
+        while ((n = read(fd, buffer, BULK_LOAD_BUFFER_SIZE)) > 0) bulk_parse(p, buffer, (size_t)n);
+        if (n < 0) {
+            printf("Error while reading %s.\n", path);
+            result = -1;
+        }
+        free(buffer);
+    }
+
+    if (p->in_number) bulk_end_number(p);
+    bulk_flush(p);
+    if (result == 0) result = p->total;
+    free(p);
+    if (!from_stdin) close(fd);
+    return result;
+}
+
+#endif
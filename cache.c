@@ -0,0 +1,371 @@
+/*
+Cache with LRU, LFU and SLRU eviction - doubly linked lists + hash map index
+
+A cache holds at most capacity key/value pairs in front of a slow backing lookup. When it is full and a new
+key comes in, one entry (the victim) is evicted, chosen by the eviction policy:
+- LRU (least recently used): evict the entry that was accessed longest ago
+- LFU (least frequently used): evict the entry with the fewest accesses (the least recently used one among ties)
+- SLRU (segmented LRU): new entries go to a probation segment, and are promoted to a protected segment on
+  their second access. Victims come from the probation segment first, so a burst of keys that are used only
+  once (e.g. a scan) cannot push the frequently used keys out of the cache
+
+Recency order is kept in doubly linked lists with a circular sentinel node, as in the dll handle of
+doubly_linked_list.c: the most recently used entry is at the head, the victim at the tail, and moving an entry
+to the head is an O(1) unlink + relink given its node ptr. The node ptr itself is found in O(1) through a hash
+map index from key to node (hash_map.h), instead of an O(n) search_data().
+
+For LFU, there is one such list per access count, and a second hash map from access count to its list.
+Together with the smallest access count in the cache (min_freq), this makes every LFU operation O(1) too.
+
+Entries and LFU lists are allocated from cache_allocator, and the hash maps from hash_map_allocator (see allocator.h).
+
+Compile with -lm (the Zipf workload uses pow(), see "zipf.h")
+
+---IMPLEMENTED OPERATIONS---
+
+1. Get (counts a hit or a miss and updates recency/frequency on a hit)
+2. Put (inserts or updates, evicting a victim if the cache is full)
+3. Evict one entry
+4. Get-or-load through a backing lookup function
+5. Allocate entries and lists from a pluggable allocator (cache_allocator), e.g. a tracking allocator
+6. Hit rate and ops/s report for each policy on a skewed (Zipf) workload (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+#include "hash_map.h"
+#include "zipf.h"
+
+typedef enum cache_policy {
+    POLICY_LRU,
+    POLICY_LFU,
+    POLICY_SLRU
+} cache_policy;
+
+// Cache entry, linked into one recency list
+typedef struct node {
+    int key;
+    int value;
+    int freq;       // number of accesses (LFU)
+    bool protected; // true if the entry is in the protected segment (SLRU)
+    struct node *next;
+    struct node *prev;
+} node;
+
+// Doubly linked list with a circular sentinel: sentinel.next is the head (most recent), sentinel.prev the tail
+typedef struct dll {
+    node sentinel;
+    int length;
+} dll;
+
+typedef struct cache {
+    cache_policy policy;
+    int capacity;
+    int size;
+    hash_map index;      // key -> node*
+    dll recency;         // LRU: all entries. SLRU: probation segment
+    dll protected_seg;   // SLRU: protected segment
+    int protected_capacity;
+    hash_map freq_lists; // LFU: access count -> dll* of the entries with that count
+    int min_freq;        // LFU: smallest access count in the cache
+    long hits, misses, evictions;
+} cache;
+
+allocator *cache_allocator; // NULL for malloc()/free()
+
+
+
+// Initialize an empty list
+void dll_init(dll *list) {
+    list->sentinel.next = &list->sentinel;
+    list->sentinel.prev = &list->sentinel;
+    list->length = 0;
+}
+
+
+// Link node at the head of the list
+void dll_push_front(dll *list, node *n) {
+    n->prev = &list->sentinel;
+    n->next = list->sentinel.next;
+    list->sentinel.next->prev = n;
+    list->sentinel.next = n;
+    list->length++;
+}
+
+
+// Unlink node from the list, without freeing it
+void dll_unlink(dll *list, node *n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    list->length--;
+}
+
+
+// Return the tail of the list (least recently used), or NULL if the list is empty
+node* dll_tail(dll *list) {
+    return list->length == 0 ? NULL : list->sentinel.prev;
+}
+
+
+// LFU: return the list of entries accessed freq times, creating it if create is true
+dll* freq_list(cache *c, int freq, bool create) {
+    void *list = NULL;
+    if (!hash_map_get(&c->freq_lists, freq, &list) && create) {
+        list = ds_alloc(cache_allocator, sizeof(dll));
+        dll_init((dll*)list);
+        hash_map_put(&c->freq_lists, freq, list);
+    }
+    return (dll*)list;
+}
+
+
+// LFU: unlink node from its frequency list, dropping the list if it becomes empty
+void freq_unlink(cache *c, node *n) {
+    dll *list = freq_list(c, n->freq, false);
+    dll_unlink(list, n);
+    if (list->length == 0) {
+        hash_map_remove(&c->freq_lists, n->freq);
+        ds_free(cache_allocator, list, sizeof(dll));
+    }
+}
+
+
+// Initialize an empty cache with the given policy and capacity (> 0)
+void cache_init(cache *c, cache_policy policy, int capacity) {
+    c->policy = policy;
+    c->capacity = capacity;
+    c->size = 0;
+    hash_map_init(&c->index);
+    hash_map_reserve(&c->index, capacity);
+    dll_init(&c->recency);
+    dll_init(&c->protected_seg);
+    c->protected_capacity = capacity * 4 / 5; // 80% protected, 20% probation
+    hash_map_init(&c->freq_lists);
+    c->min_freq = 0;
+    c->hits = c->misses = c->evictions = 0;
+}
+
+
+// Record an access to an entry that is in the cache
+void touch(cache *c, node *n) {
+    switch (c->policy) {
+    case POLICY_LRU:
+        dll_unlink(&c->recency, n);
+        dll_push_front(&c->recency, n);
+        break;
+
+    case POLICY_LFU:
+        freq_unlink(c, n);
+        if (n->freq == c->min_freq && freq_list(c, n->freq, false) == NULL) c->min_freq++;
+        n->freq++;
+        dll_push_front(freq_list(c, n->freq, true), n);
+        break;
+
+    case POLICY_SLRU:
+        if (n->protected) {
+            dll_unlink(&c->protected_seg, n);
+            dll_push_front(&c->protected_seg, n);
+            break;
+        }
+        // Second access: promote from probation to protected. If the protected segment overflows,
+        // its least recently used entry goes back to the head of probation and gets another chance
+        dll_unlink(&c->recency, n);
+        n->protected = true;
+        dll_push_front(&c->protected_seg, n);
+        if (c->protected_seg.length > c->protected_capacity) {
+            node *demoted = dll_tail(&c->protected_seg);
+            dll_unlink(&c->protected_seg, demoted);
+            demoted->protected = false;
+            dll_push_front(&c->recency, demoted);
+        }
+        break;
+    }
+}
+
+
+// Evict one entry chosen by the cache's policy
+void cache_evict(cache *c) {
+    if (c->size == 0) {
+        printf("Cache is empty. Nothing to evict.\n");
+        return;
+    }
+
+    node *victim;
+    switch (c->policy) {
+    case POLICY_LFU:
+        // min_freq is exact after every put. Only repeated evictions without puts (e.g. cache_free()) can
+        // empty its list, and then we look for the next non-empty one
+        while (freq_list(c, c->min_freq, false) == NULL) c->min_freq++;
+        victim = dll_tail(freq_list(c, c->min_freq, false));
+        freq_unlink(c, victim);
+        break;
+    case POLICY_SLRU:
+        victim = dll_tail(&c->recency);
+        if (victim != NULL) dll_unlink(&c->recency, victim);
+        else {
+            victim = dll_tail(&c->protected_seg);
+            dll_unlink(&c->protected_seg, victim);
+        }
+        break;
+    default:
+        victim = dll_tail(&c->recency);
+        dll_unlink(&c->recency, victim);
+        break;
+    }
+
+    hash_map_remove(&c->index, victim->key);
+    ds_free(cache_allocator, victim, sizeof(node));
+    c->size--;
+    c->evictions++;
+}
+
+
+// Look up key. On a hit, sets *value, records the access and returns true. On a miss, returns false
+bool cache_get(cache *c, int key, int *value) {
+    void *found;
+    COUNT(searches);
+    if (!hash_map_get(&c->index, key, &found)) {
+        c->misses++;
+        return false;
+    }
+    node *n = (node*)found;
+    COUNT(nodes_visited); // the index leads straight to the one entry that is read
+    touch(c, n);
+    *value = n->value;
+    c->hits++;
+    return true;
+}
+
+
+// Insert key with value, or update its value if it is already cached. Evicts an entry if the cache is full
+void cache_put(cache *c, int key, int value) {
+    void *found;
+    if (hash_map_get(&c->index, key, &found)) {
+        node *n = (node*)found;
+        n->value = value;
+        touch(c, n);
+        return;
+    }
+
+    if (c->size == c->capacity) cache_evict(c);
+
+    node *n = (node*)ds_alloc(cache_allocator, sizeof(node));
+    n->key = key;
+    n->value = value;
+    n->freq = 1;
+    n->protected = false;
+    if (c->policy == POLICY_LFU) {
+        dll_push_front(freq_list(c, 1, true), n);
+        c->min_freq = 1;
+    }
+    else dll_push_front(&c->recency, n); // LRU list, or SLRU probation segment
+    hash_map_put(&c->index, key, n);
+    c->size++;
+}
+
+
+// Return the cached value of key, calling load(key) on a miss and caching its result
+int cache_get_or_load(cache *c, int key, int (*load)(int)) {
+    int value;
+    if (cache_get(c, key, &value)) return value;
+    value = load(key);
+    cache_put(c, key, value);
+    return value;
+}
+
+
+// Free all entries and lists
+void cache_free(cache *c) {
+    while (c->size > 0) cache_evict(c);
+    hash_map_free(&c->index);
+    hash_map_free(&c->freq_lists);
+}
+
+
+// Print hit rate and counters
+void cache_print_stats(cache *c, const char *name) {
+    long lookups = c->hits + c->misses;
+    printf("%-5s capacity %d: %ld lookups, hit rate %.2f%%, %ld evictions\n",
+           name, c->capacity, lookups, lookups > 0 ? 100.0 * c->hits / lookups : 0.0, c->evictions);
+}
+
+
+
+// Stand-in for a slow backing lookup (e.g. a database query)
+int slow_lookup(int key) {
+    volatile unsigned int x = key;
+    for (int i = 0; i < 200; i++) x = x * 31 + i;
+    return key * 2;
+}
+
+
+// Run a Zipf workload with occasional one-off scans through each policy and report hit rate and ops/s
+void run_benchmark(int num_keys, int capacity, int ops, double skew) {
+    double *cdf = zipf_cdf(num_keys, skew);
+
+    cache_policy policies[] = {POLICY_LRU, POLICY_LFU, POLICY_SLRU};
+    const char *names[] = {"LRU", "LFU", "SLRU"};
+    for (int p = 0; p < 3; p++) {
+        cache c;
+        cache_init(&c, policies[p], capacity);
+        unsigned long long state = 88172645463325252ull;
+        int scan_key = num_keys;
+        long checksum = 0;
+
+        clock_t start = clock();
+        for (int i = 0; i < ops; i++) {
+            int key;
+            if (i % 1000 < 50) key = scan_key++; // 5% of the accesses are a scan over keys never seen again
+            else key = next_zipf(cdf, num_keys, &state);
+            checksum += cache_get_or_load(&c, key, slow_lookup);
+        }
+        double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        cache_print_stats(&c, names[p]);
+        printf("      %.2f M ops/s (checksum %ld)\n", secs > 0 ? ops / secs / 1e6 : 0.0, checksum);
+        cache_free(&c);
+    }
+    free(cdf);
+}
+
+
+
+int main() {
+    // One tracker for the entries, the lists and the hash map slots
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    cache_allocator = &tracker.base;
+    hash_map_allocator = &tracker.base;
+
+    cache c;
+    int capacity, n, key, value;
+    printf("Enter the capacity of the LRU cache: ");
+    scanf("%d", &capacity);
+    if (capacity < 1) capacity = 1;
+    cache_init(&c, POLICY_LRU, capacity);
+
+    printf("Enter the number of keys to put into the cache: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter key: ");
+        scanf("%d", &key);
+        cache_put(&c, key, key * 10);
+    }
+
+    printf("Get 99: %s\n", cache_get(&c, 99, &value) ? "hit" : "miss");
+    if (n > 0 && cache_get(&c, key, &value)) printf("Get %d (last key put): hit, value %d\n", key, value);
+    cache_print_stats(&c, "LRU");
+    tracking_report(&tracker, "LRU cache", c.size);
+    counters_print();
+    cache_free(&c);
+    cache_allocator = NULL;
+    hash_map_allocator = NULL;
+
+    run_benchmark(100000, 1000, 2000000, 1.0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+// This header file contains operation counters for the data structures, defined here so that every source
+// file can include it. The counters show where the time of an operation goes, e.g. how many comparisons a BST
+// insert needs (which grows with the height of the tree), or how many nodes a linked list search visits.
+//
+// nodes_visited means the same in every structure: the number of nodes the operation dereferenced, i.e. whose
+// fields it read. A walk to position n reads the n-1 nodes before it and returns the nth one without reading it,
+// a search reads every node it compares, and a lookup answered by an index or a filter reads none. Blocks of the
+// unrolled list count as nodes, and tagged leaves of the ART (art.c), which hold their key in the ptr, do not.
+//
+// The counters are switched on at compile time with -DDS_COUNTERS. Without it, COUNT() and COUNT_ADD() expand
+// to nothing, so the generated code is exactly the same as without instrumentation.
+//
+// Every thread has its own set of counters (_Thread_local), so counting does not need atomic operations and
+// threads do not slow each other down. counters_snapshot() and counters_reset() act on the calling thread's set.
+
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+
+typedef struct ds_counters {
+    long bst_inserts;
+    long bst_insert_comparisons; // comparisons with node data on the way down, over all BST inserts
+    long searches;               // lookups by position or key: get_nodep(), search_data(), search(), find(), cache_get() ...
+    long nodes_visited;          // nodes dereferenced by those lookups (see above)
+    long filter_rejections;      // searches answered by a Bloom filter (bloom.h) without visiting any node
+    long hash_lookups;           // slot searches in a hash map (hash_map.h), by get, put and remove
+    long hash_probes;            // slots read by those searches
+    long heap_comparisons;       // element comparisons while sifting up or down in heap.c
+    long stack_resizes;          // array growths in stack.c
+    long queue_full_rejections;  // enqueue() calls rejected because the queue was full
+    long queue_empty_rejections; // dequeue()/_front() calls rejected because the queue was empty
+    long allocations;
+    long frees;
+} ds_counters;
+
+#ifdef DS_COUNTERS
+_Thread_local ds_counters ds_thread_counters;
+#define COUNT(field) (ds_thread_counters.field++)
+#define COUNT_ADD(field, n) (ds_thread_counters.field += (n))
+#else
+#define COUNT(field) ((void)0)
+#define COUNT_ADD(field, n) ((void)0)
+#endif
+
+
+// Return a copy of the calling thread's counters (all zeros when compiled without DS_COUNTERS)
+ds_counters counters_snapshot() {
+#ifdef DS_COUNTERS
+    return ds_thread_counters;
+#else
+    ds_counters zero = {0};
+    return zero;
+#endif
+}
+
+
+// Set the calling thread's counters to zero
+void counters_reset() {
+#ifdef DS_COUNTERS
+    ds_counters zero = {0};
+    ds_thread_counters = zero;
+#endif
+}
+
+
+// Print the non-zero counters of the calling thread, with per-operation averages. Prints nothing when compiled
+// without DS_COUNTERS
+void counters_print() {
+#ifdef DS_COUNTERS
+    ds_counters c = counters_snapshot();
+    printf("\n--Counters--\n");
+    if (c.bst_inserts > 0) {
+        printf("BST inserts: %ld, comparisons: %ld (%.2f per insert)\n",
+               c.bst_inserts, c.bst_insert_comparisons, (double)c.bst_insert_comparisons / c.bst_inserts);
+    }
+    if (c.searches > 0) {
+        printf("Searches: %ld, nodes visited: %ld (%.2f per search)\n",
+               c.searches, c.nodes_visited, (double)c.nodes_visited / c.searches);
+    }
+    if (c.filter_rejections > 0) printf("Searches rejected by a Bloom filter: %ld\n", c.filter_rejections);
+    if (c.hash_lookups > 0) {
+        printf("Hash map lookups: %ld, slots probed: %ld (%.2f per lookup)\n",
+               c.hash_lookups, c.hash_probes, (double)c.hash_probes / c.hash_lookups);
+    }
+    if (c.heap_comparisons > 0) printf("Heap comparisons: %ld\n", c.heap_comparisons);
+    if (c.stack_resizes > 0) printf("Stack resizes: %ld\n", c.stack_resizes);
+    if (c.queue_full_rejections > 0 || c.queue_empty_rejections > 0) {
+        printf("Queue rejections: %ld full, %ld empty\n", c.queue_full_rejections, c.queue_empty_rejections);
+    }
+    printf("Allocations: %ld, frees: %ld\n", c.allocations, c.frees);
+    printf("--End counters--\n\n");
+#endif
+}
+
+#endif
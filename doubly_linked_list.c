@@ -16,7 +16,10 @@ Doubly Linked List (DLL) in C
 3. Access node:
 - given n, return ptr to node at nth position
 
-4. Search node (linear search)
+4. Search node (linear search), with an optional Bloom filter (node_filter, see "bloom.h"), set with set_node_filter(),
+that rejects data never inserted without walking the DLL, and an optional hash map index (node_index, see "hash_map.h"), set with
+set_node_index(), that finds the node in O(1) expected instead of walking the DLL. Every insert and delete keeps the
+index up to date. With duplicate data, the index holds one of the copies, not necessarily the first one in DLL order
 
 5. Print the entire doubly linked list data
 - iteratively
@@ -24,16 +27,42 @@ Doubly Linked List (DLL) in C
 
 6. Get length of a doubly linked list (number of nodes)
 
+7. DLL handle (dll) with a circular sentinel node, tail pointer and cached length:
+- push/pop at the beginning and at the end in O(1)
+- get ptr to node at nth position, walking from whichever end is closer
+- free all nodes
+- nodes come from the allocator passed to dll_init(), and a tracking allocator reports the memory used by one handle (see "allocator.h")
+- save to a snapshot file, and append the data of a snapshot file (see "snapshot.h")
+- bulk load data from a file or stdin: run the program with the file name as its argument ("-" for stdin) (see "bulk_load.h")
+- optional Bloom filter in front of dll_search_data(), set with dll_set_filter() (see "bloom.h")
+- optional hash map index in front of dll_search_data(), set with dll_set_index() (see "hash_map.h")
+- convert to and from a compressed bitmap set of ints (see "roaring.h"). The bitmap is a set: duplicates are lost,
+  and the data comes back sorted
+
 
 
 ---EXTRA NOTES---
 Reversing a doubly linked list is easy. First get the length of the DLL using get_length(). Then pass that into
 get_nodep() to get the ptr to the last node, and assign the return value to *head (where head is of type node**).
+
+The functions above take a bare head ptr, so every operation at the end of the list (insert_end(), del_end()) has to
+walk the whole DLL first, even though every node has a prev ptr. The dll handle fixes this by keeping a sentinel node
+whose next ptr is the first node and whose prev ptr is the last node (the tail ptr). The sentinel closes the list into a
+circle, so the first and last nodes are never special cases: every real node always has a valid prev and next node.
+Together with the cached length, this makes push/pop at both ends O(1), and lets dll_get_nodep() walk backwards from
+the tail when n is in the second half of the list, which halves the average cost of positional access.
 */
 
 
 #include <stdio.h>
 #include<stdlib.h>
+#include "snapshot.h"
+#include "bulk_load.h"
+#include "counters.h"
+#include "allocator.h"
+#include "roaring.h"
+#include "bloom.h"
+#include "hash_map.h"
 
 // Doubly Linked List node
 typedef struct node {
@@ -42,6 +71,50 @@ typedef struct node {
     struct node *prev;
 } node;
 
+// Allocator for the nodes of the DLLs handled through a head ptr (NULL for malloc()/free())
+allocator *node_allocator;
+
+// Optional Bloom filter of the data in the DLLs handled through a head ptr (NULL for none). Set it with set_node_filter()
+bloom *node_filter;
+
+// Optional index from data to a node holding it, for one DLL handled through a head ptr (NULL for none). Set it with
+// set_node_index()
+hash_map *node_index;
+
+// Number of nodes whose data was already in node_index when they were inserted (copies the index does not point to)
+int node_index_duplicates;
+
+
+
+// Add a new node to index (NULL for none). If its data is already indexed, the node is only counted in *duplicates
+void index_add(hash_map *index, int *duplicates, node *new_node) {
+    if (index == NULL) return;
+    if (hash_map_get(index, new_node->data, NULL)) (*duplicates)++;
+    else hash_map_put(index, new_node->data, new_node);
+}
+
+
+// Drop a node about to be deleted from index (NULL for none). If it is the indexed node for its data, and the DLL has
+// duplicates, walk the nodes from first up to end (excluded) for another copy of the data and index that one instead.
+// Without duplicates there is no walk
+void index_remove(hash_map *index, int *duplicates, node *del_node, node *first, node *end) {
+    if (index == NULL) return;
+    void *indexed;
+    if (!hash_map_get(index, del_node->data, &indexed)) return;
+    if (indexed != del_node) {
+        (*duplicates)--;
+        return;
+    }
+    hash_map_remove(index, del_node->data);
+    if (*duplicates == 0) return;
+    for (node *temp = first; temp != end; temp = temp->next) {
+        if (temp != del_node && temp->data == del_node->data) {
+            hash_map_put(index, temp->data, temp);
+            (*duplicates)--;
+            return;
+        }
+    }
+}
 
 
 // Print Doubly Linked List
@@ -85,8 +158,10 @@ void reverse_printLL(node *head) {
 
 // Insert node at the beginning
 void insert_beg(node **head, int x) {
-    node* new_node = (node*)malloc(sizeof(node)); //allocate memory for new node
+    node* new_node = (node*)ds_alloc(node_allocator, sizeof(node)); //allocate memory for new node
     new_node->data = x; //assign data
+    bloom_add(node_filter, x);
+    index_add(node_index, &node_index_duplicates, new_node);
     new_node->next = *head; //assign the next pointer of the new node to head, which is currently pointing to the 1st node
     new_node->prev = NULL;
     *head = new_node; //reassign head to the address of the new node. head now points to the new node
@@ -100,9 +175,11 @@ void insert_beg(node **head, int x) {
 
 // Insert node at the end
 void insert_end(node **head, int x) {
-    node* new_node = (node*)malloc(sizeof(node));
+    node* new_node = (node*)ds_alloc(node_allocator, sizeof(node));
     new_node->data = x;
     new_node->next = NULL;
+    bloom_add(node_filter, x);
+    index_add(node_index, &node_index_duplicates, new_node);
 
     // Add the new node and return immediately if LL is empty
     if (*head == NULL) {
@@ -129,12 +206,13 @@ void del_beg(node **head) {
     }
 
     node *first = *head;
+    index_remove(node_index, &node_index_duplicates, first, *head, NULL);
     *head = first->next;
     if (first->next != NULL) {
         node *second = first->next;
         second->prev = NULL;
     }
-    free(first);
+    ds_free(node_allocator, first, sizeof(node));
 }
 
 
@@ -145,8 +223,9 @@ void del_end(node **head) {
         return;
     }
     else if ((*head)->next == NULL) { //Edge case when only one node is present
-        free(head);
-        head = NULL;
+        index_remove(node_index, &node_index_duplicates, *head, *head, NULL);
+        ds_free(node_allocator, *head, sizeof(node));
+        *head = NULL;
         printf("Last node deleted.\n");
         return;
     }
@@ -154,8 +233,9 @@ void del_end(node **head) {
     node *temp = *head;
     while(temp->next->next!=NULL) temp = temp->next;
     node *last_node = temp->next;
+    index_remove(node_index, &node_index_duplicates, last_node, *head, NULL);
     temp->next = NULL;
-    free(last_node);
+    ds_free(node_allocator, last_node, sizeof(node));
 
     printf("Last node deleted.\n");
     // Or we can do this:
@@ -174,8 +254,10 @@ node* get_nodep(node **head, int n) {
     // if *head != NULL, create new temp node pointer to traverse LL
     int node_count = 0;
     node *temp = *head;
+    COUNT(searches);
     while (node_count < n-1) {
         //printf("Data: %d\n", temp->num);
+        COUNT(nodes_visited);
         temp = temp->next;
         if (temp == NULL) {
             printf("LL too small\n");
@@ -188,15 +270,26 @@ node* get_nodep(node **head, int n) {
 }
 
 
-// Linear search
+// Linear search. If node_filter is set, data it has never seen is rejected without walking the DLL.
+// If node_index is set, the node is looked up in it instead of walking the DLL
 node* search_data(node *head, int num) {
     if (head == NULL) {
         printf("LL empty!\n");
         return NULL;
     }
 
+    COUNT(searches);
+    if (!bloom_maybe_contains(node_filter, num)) {
+        COUNT(filter_rejections);
+        return NULL;
+    }
+    if (node_index != NULL) {
+        void *found;
+        return hash_map_get(node_index, num, &found) ? (node*)found : NULL;
+    }
     node *temp = head;
     while (temp!=NULL) {
+        COUNT(nodes_visited);
         if (temp->data == num) return temp; // return ptr to node if data found
         temp = temp->next;
     }
@@ -205,6 +298,24 @@ node* search_data(node *head, int num) {
 }
 
 
+// Put the Bloom filter filter (NULL for none) in front of search_data(), for the DLL at head, and add the data already in it
+void set_node_filter(node *head, bloom *filter) {
+    node_filter = filter;
+    if (filter == NULL) return;
+    for (node *temp = head; temp != NULL; temp = temp->next) bloom_add(filter, temp->data);
+}
+
+
+// Put the index index (NULL for none) in front of search_data(), for the DLL at head, and add the nodes already in it
+void set_node_index(node *head, hash_map *index) {
+    node_index = index;
+    node_index_duplicates = 0;
+    if (index == NULL) return;
+    hash_map_clear(index);
+    for (node *temp = head; temp != NULL; temp = temp->next) index_add(index, &node_index_duplicates, temp);
+}
+
+
 // Get length of DLL, that is, number of nodes
 int get_length(node *head) {
     int num_nodes = 0;
@@ -246,10 +357,12 @@ void insert_node(node **head, int n, int x) {
 
     // create new node, assign it a value, and point it to where the ptr to nth node was pointing
     node *nth_node = get_nodep(head, n);
-    node *new_node = (node*)malloc(sizeof(node));
+    node *new_node = (node*)ds_alloc(node_allocator, sizeof(node));
 
     new_node->data = x;
     new_node->next = nth_node;
+    bloom_add(node_filter, x);
+    index_add(node_index, &node_index_duplicates, new_node);
     node *n_minus_one_node = nth_node->prev;
     nth_node->prev = new_node;
 
@@ -284,21 +397,279 @@ void delete_node(node **head, int n) {
     // special case when the first node is to be deleted. We need to reassign head directly
     if (n==1) {
         node *temp = *head;
+        index_remove(node_index, &node_index_duplicates, temp, *head, NULL);
         *head = (*head)->next;
-        (*head)->prev = NULL;
-        free(temp);
+        if (*head != NULL) (*head)->prev = NULL;
+        ds_free(node_allocator, temp, sizeof(node));
         return;
     }
     else {
         node *del_node = get_nodep(head, n);
+        index_remove(node_index, &node_index_duplicates, del_node, *head, NULL);
         del_node->prev->next = del_node->next;
-        del_node->next->prev = del_node->prev;
-        free(del_node);
+        if (del_node->next != NULL) del_node->next->prev = del_node->prev;
+        ds_free(node_allocator, del_node, sizeof(node));
     }
 }
 
 
-int main() {
+// DLL handle. sentinel.next is the first node and sentinel.prev is the last node (the tail).
+// An empty DLL has both of them pointing back at the sentinel itself.
+// Every handle has its own allocator for its nodes (NULL for malloc()/free()), set once by dll_init(),
+// and optionally a Bloom filter of its data (NULL for none), set by dll_set_filter(), and an index from its data to
+// its nodes (NULL for none), set by dll_set_index().
+typedef struct dll {
+    node sentinel;
+    int length;
+    allocator *alloc;
+    bloom *filter;
+    hash_map *index;
+    int index_duplicates; // nodes whose data was already indexed when they were inserted
+} dll;
+
+
+// Initialize an empty DLL handle whose nodes are allocated from alloc (NULL for malloc()/free())
+void dll_init(dll *list, allocator *alloc) {
+    list->sentinel.next = &list->sentinel;
+    list->sentinel.prev = &list->sentinel;
+    list->length = 0;
+    list->alloc = alloc;
+    list->filter = NULL;
+    list->index = NULL;
+    list->index_duplicates = 0;
+}
+
+
+// Link a new node holding x between the nodes before and after. Both always exist thanks to the sentinel
+node* dll_link(dll *list, node *before, node *after, int x) {
+    node *new_node = (node*)ds_alloc(list->alloc, sizeof(node));
+    new_node->data = x;
+    new_node->prev = before;
+    new_node->next = after;
+    before->next = new_node;
+    after->prev = new_node;
+    list->length++;
+    bloom_add(list->filter, x);
+    index_add(list->index, &list->index_duplicates, new_node);
+    return new_node;
+}
+
+
+// Unlink and free a (non-sentinel) node
+void dll_unlink(dll *list, node *del_node) {
+    index_remove(list->index, &list->index_duplicates, del_node, list->sentinel.next, &list->sentinel);
+    del_node->prev->next = del_node->next;
+    del_node->next->prev = del_node->prev;
+    ds_free(list->alloc, del_node, sizeof(node));
+    list->length--;
+}
+
+
+// Insert node at the beginning in O(1)
+void dll_push_front(dll *list, int x) {
+    dll_link(list, &list->sentinel, list->sentinel.next, x);
+}
+
+
+// Insert node at the end in O(1), using the tail ptr instead of walking the DLL
+void dll_push_back(dll *list, int x) {
+    dll_link(list, list->sentinel.prev, &list->sentinel, x);
+}
+
+
+// Delete node at the beginning in O(1)
+void dll_pop_front(dll *list) {
+    if (list->length == 0) {
+        printf("DLL is empty! Nothing to delete\n");
+        return;
+    }
+    dll_unlink(list, list->sentinel.next);
+}
+
+
+// Delete node at the end in O(1)
+void dll_pop_back(dll *list) {
+    if (list->length == 0) {
+        printf("DLL is empty! Nothing to delete\n");
+        return;
+    }
+    dll_unlink(list, list->sentinel.prev);
+}
+
+
+// Get pointer to node at nth position (n>0), walking from the head or the tail, whichever is closer
+node* dll_get_nodep(dll *list, int n) {
+    if (n < 1 || n > list->length) {
+        printf("DLL has %d nodes, no node at position %d\n", list->length, n);
+        return NULL;
+    }
+
+    node *temp;
+    COUNT(searches);
+    if (n - 1 <= list->length - n) { // n-1 steps from the head, length-n from the tail
+        temp = list->sentinel.next;
+        for (int i = 1; i < n; i++) temp = temp->next;
+        COUNT_ADD(nodes_visited, n - 1);
+    }
+    else {
+        temp = list->sentinel.prev;
+        for (int i = list->length; i > n; i--) temp = temp->prev;
+        COUNT_ADD(nodes_visited, list->length - n);
+    }
+    return temp;
+}
+
+
+// Insert node at nth position (1 <= n <= length+1) with the data x
+void dll_insert_node(dll *list, int n, int x) {
+    if (n < 1 || n > list->length + 1) {
+        printf("DLL too small for a node to be added at %dth position\n", n);
+        return;
+    }
+
+    // The node that will end up after the new one. For n == length+1 this is the sentinel, i.e. we push at the end
+    node *after = (n == list->length + 1) ? &list->sentinel : dll_get_nodep(list, n);
+    dll_link(list, after->prev, after, x);
+}
+
+
+// Delete node at nth position
+void dll_delete_node(dll *list, int n) {
+    node *del_node = dll_get_nodep(list, n);
+    if (del_node == NULL) return;
+    dll_unlink(list, del_node);
+}
+
+
+// Print the DLL from head to tail
+void dll_print(dll *list) {
+    if (list->length == 0) {
+        printf("DLL is empty!\n");
+        return;
+    }
+
+    printf("\n--Start LL--\n");
+    for (node *temp = list->sentinel.next; temp != &list->sentinel; temp = temp->next) {
+        printf("Data: %d\n", temp->data);
+    }
+    printf("--End LL--\n\n");
+}
+
+
+// Free all nodes. The handle is left as an empty DLL and can be reused. Its filter and index (if any) are kept, and cleared
+void dll_free(dll *list) {
+    node *temp = list->sentinel.next;
+    while (temp != &list->sentinel) {
+        node *next = temp->next;
+        ds_free(list->alloc, temp, sizeof(node));
+        temp = next;
+    }
+    bloom *filter = list->filter;
+    hash_map *index = list->index;
+    dll_init(list, list->alloc);
+    if (filter != NULL) bloom_clear(filter);
+    if (index != NULL) hash_map_clear(index);
+    list->filter = filter;
+    list->index = index;
+}
+
+
+// Put the Bloom filter filter (NULL for none) in front of dll_search_data(), and add the data already in the DLL to it
+void dll_set_filter(dll *list, bloom *filter) {
+    list->filter = filter;
+    for (node *temp = list->sentinel.next; temp != &list->sentinel; temp = temp->next) bloom_add(filter, temp->data);
+}
+
+
+// Put the index index (NULL for none) in front of dll_search_data(), and add the nodes already in the DLL to it
+void dll_set_index(dll *list, hash_map *index) {
+    list->index = index;
+    list->index_duplicates = 0;
+    if (index == NULL) return;
+    hash_map_clear(index);
+    hash_map_reserve(index, list->length);
+    for (node *temp = list->sentinel.next; temp != &list->sentinel; temp = temp->next) index_add(index, &list->index_duplicates, temp);
+}
+
+
+// Linear search. Data the filter has never seen is rejected without walking the DLL, and with an index, the node is
+// looked up in it instead of walking the DLL
+node* dll_search_data(dll *list, int num) {
+    COUNT(searches);
+    if (!bloom_maybe_contains(list->filter, num)) {
+        COUNT(filter_rejections);
+        return NULL;
+    }
+    if (list->index != NULL) {
+        void *found;
+        return hash_map_get(list->index, num, &found) ? (node*)found : NULL;
+    }
+    for (node *temp = list->sentinel.next; temp != &list->sentinel; temp = temp->next) {
+        COUNT(nodes_visited);
+        if (temp->data == num) return temp;
+    }
+    return NULL;
+}
+
+
+// Save the DLL to a snapshot file. Returns true on success
+bool dll_save(dll *list, const char *path) {
+    int32_t *data = (int32_t*)malloc(sizeof(int32_t) * (list->length > 0 ? list->length : 1));
+    int i = 0;
+    for (node *temp = list->sentinel.next; temp != &list->sentinel; temp = temp->next) data[i++] = temp->data;
+    bool ok = snapshot_write(path, SNAPSHOT_LIST, SNAPSHOT_NIL, data, list->length, sizeof(int32_t));
+    free(data);
+    return ok;
+}
+
+
+// Append the data saved in a snapshot file to the end of the DLL, reading it straight from the mapped file.
+// Returns true on success
+bool dll_load(dll *list, const char *path) {
+    snapshot snap;
+    if (!snapshot_open(&snap, path, SNAPSHOT_LIST, true)) return false;
+    const int32_t *data = (const int32_t*)snap.payload;
+    for (uint32_t i = 0; i < snap.header->count; i++) dll_push_back(list, data[i]);
+    snapshot_close(&snap);
+    return true;
+}
+
+// Append a batch of bulk-loaded data to the end of the DLL handle passed as ctx
+void dll_load_batch(int *batch, int count, void *ctx) {
+    for (int i = 0; i < count; i++) dll_push_back((dll*)ctx, batch[i]);
+}
+
+// Add the data of all nodes of the DLL to the roaring bitmap r (initialized by the caller)
+void dll_to_roaring(dll *list, roaring *r) {
+    for (node *temp = list->sentinel.next; temp != &list->sentinel; temp = temp->next) roaring_add(r, temp->data);
+}
+
+// Append one value of a roaring bitmap to the end of the DLL handle passed as ctx
+void dll_append_value(int value, void *ctx) {
+    dll_push_back((dll*)ctx, value);
+}
+
+// Append all values of the roaring bitmap r to the end of the DLL, in increasing order
+void roaring_to_dll(roaring *r, dll *list) {
+    roaring_iterate(r, dll_append_value, list);
+}
+
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        // Bulk load from a file ("-" for stdin) instead of prompting for every element
+        tracking_allocator tracker;
+        tracking_init(&tracker, NULL);
+        dll loaded_list;
+        dll_init(&loaded_list, &tracker.base);
+        long loaded = bulk_load(argv[1], dll_load_batch, &loaded_list);
+        printf("Loaded %ld elements. DLL has %d nodes\n", loaded, loaded_list.length);
+        tracking_report(&tracker, "DLL handle", loaded_list.length);
+        counters_print();
+        dll_free(&loaded_list);
+        return loaded < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     // Initialize head node ptr to NULL. This means that, initially, the LL is empty and the head doesn't point to a valid node.
     node *head = NULL;
     int num_elements, x;
@@ -314,7 +685,12 @@ int main() {
 
     printLL(head);
 
+    // Index the DLL: search_data() no longer walks it, and inserts and deletes keep the index up to date
+    hash_map head_index;
+    hash_map_init(&head_index);
+    set_node_index(head, &head_index);
     insert_node(&head,3,99);
+    printf("Indexed search for 99: %s\n", search_data(head, 99) != NULL ? "found" : "not found");
 
     printLL(head);
     reverse_printLL(head);
@@ -322,4 +698,49 @@ int main() {
     // node *test_ptr;
     // test_ptr = get_nodep(&head, 2);
     // printf("Data at node 2 is %d\n", test_ptr->data);
+
+    // Same operations through the dll handle: both ends are O(1), positional access starts from the closer end
+    // The handle gets its own tracking allocator, so we can see the memory used by this one DLL
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    dll list;
+    dll_init(&list, &tracker.base);
+    for (int i=1; i<=5; i++) dll_push_back(&list, i);
+    dll_push_front(&list, 0);
+    dll_insert_node(&list, 6, 99);
+    dll_pop_back(&list);
+    dll_print(&list);
+    bloom filter;
+    bloom_init(&filter, &tracker.base, 1024, 0.01); // counted in the handle's memory report
+    dll_set_filter(&list, &filter);
+    hash_map index;
+    hash_map_init(&index);
+    dll_set_index(&list, &index);
+    printf("Search for 99: %s. Search for 12345: %s\n", dll_search_data(&list, 99) != NULL ? "found" : "not found",
+           dll_search_data(&list, 12345) != NULL ? "found" : "not found");
+    printf("DLL handle has %d nodes, tail data is %d, data at position 5 is %d\n",
+           list.length, list.sentinel.prev->data, dll_get_nodep(&list, 5)->data);
+
+    if (dll_save(&list, "dll_snapshot.bin")) {
+        dll_load(&list, "dll_snapshot.bin");
+        printf("DLL handle has %d nodes after appending its snapshot\n", list.length);
+        remove("dll_snapshot.bin");
+    }
+    tracking_report(&tracker, "DLL handle", list.length);
+
+    // Deduplicate and sort the DLL through a roaring bitmap
+    roaring set;
+    roaring_init(&set, NULL);
+    dll_to_roaring(&list, &set);
+    dll_free(&list);
+    roaring_to_dll(&set, &list);
+    roaring_free(&set);
+    dll_print(&list);
+    counters_print();
+    dll_free(&list);
+    bloom_free(&filter);
+    hash_map_free(&index);
+    while (head != NULL) del_beg(&head);
+    set_node_index(NULL, NULL);
+    hash_map_free(&head_index);
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+Hash map (open addressing, Robin Hood hashing) - used as an index over linked list nodes
+
+search_data() in linked_list.c and doubly_linked_list.c is a linear search, O(n) per lookup. If we also keep a
+hash map from data to the ptr of the node holding it, a lookup becomes O(1) expected, while the linked list
+keeps its order and its O(1) insertion/deletion given a node ptr. The index has to be updated together
+with the list: on insert we put (data, node ptr) in the map, on delete we remove data from it. linked_list.c
+(ll_set_index()) and doubly_linked_list.c (set_node_index(), dll_set_index()) do this, and compare their
+lookup times with and without the index.
+
+The map itself is implemented in the header file hash_map.h, so that other source files can include it.
+Here it maps ints to ints, stored directly in the ptrs.
+
+---IMPLEMENTED OPERATIONS---
+
+1. Insert or replace a key (hash_map_put)
+2. Look up a key (hash_map_get)
+3. Delete a key, without tombstones (hash_map_remove)
+4. Reserve room for n keys (hash_map_reserve)
+5. Remove all keys (hash_map_clear)
+6. Allocate the slot arrays from a pluggable allocator (hash_map_allocator, see "allocator.h")
+
+Below:
+7. Probe lengths at a high load factor, and timing of puts, hits, misses and deletes (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "hash_map.h"
+
+
+
+// Print the load factor of the map, and the average and longest distance of its keys from their home slots
+void print_probe_lengths(hash_map *map) {
+    long long total = 0;
+    uint32_t longest = 0;
+    for (uint32_t i = 0; i < map->capacity; i++) {
+        uint32_t dist = map->slots[i].dist;
+        if (dist == 0) continue;
+        total += dist - 1;
+        if (dist - 1 > longest) longest = dist - 1;
+    }
+    printf("%u keys in %u slots (load factor %.2f): average distance from home slot %.2f, longest %u\n", map->size,
+           map->capacity, (double)map->size / map->capacity, map->size > 0 ? (double)total / map->size : 0.0, longest);
+}
+
+
+// Time n puts, n lookups of keys in the map, n lookups of missing keys and n deletes, with the map filled up to
+// about 90% of its slots
+void time_operations(int n) {
+    hash_map map;
+    hash_map_init(&map);
+    hash_map_reserve(&map, n);
+
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) hash_map_put(&map, 2 * i, (void*)(intptr_t)i); // only even keys, so odd keys are misses
+    double put_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    print_probe_lengths(&map);
+
+    long found = 0;
+    start = clock();
+    for (int i = 0; i < n; i++) found += hash_map_get(&map, 2 * i, NULL);
+    double hit_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int i = 0; i < n; i++) found += hash_map_get(&map, 2 * i + 1, NULL);
+    double miss_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int i = 0; i < n; i++) hash_map_remove(&map, 2 * i);
+    double remove_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%d keys: put %.1f ns, hit %.1f ns, miss %.1f ns, remove %.1f ns per operation (%ld found, %u left)\n", n,
+           put_secs * 1e9 / n, hit_secs * 1e9 / n, miss_secs * 1e9 / n, remove_secs * 1e9 / n, found, map.size);
+    hash_map_free(&map);
+}
+
+
+
+int main() {
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    hash_map_allocator = &tracker.base;
+
+    hash_map map;
+    hash_map_init(&map);
+
+    int data_elements;
+    int x;
+    printf("Enter number of keys to add to the map: ");
+    scanf("%d", &data_elements);
+    for (int i=0; i<data_elements; i++) {
+        printf("Enter key to add: ");
+        scanf("%d", &x);
+        if (hash_map_get(&map, x, NULL)) printf("%d is already in the map\n", x);
+        else hash_map_put(&map, x, (void*)(intptr_t)i);
+    }
+
+    hash_map_put(&map, 99, (void*)(intptr_t)-1);
+    void *value;
+    if (hash_map_get(&map, 99, &value)) printf("99 maps to %d\n", (int)(intptr_t)value);
+    hash_map_remove(&map, 99);
+    printf("99 in the map after remove: %d\n", hash_map_get(&map, 99, NULL));
+    print_probe_lengths(&map);
+    tracking_report(&tracker, "Hash map", map.size);
+    counters_print();
+    hash_map_free(&map);
+    hash_map_allocator = NULL;
+
+    // Just below the 90% limit, so that the map does not grow
+    time_operations((int)((1u << 20) * 0.89));
+
+    return EXIT_SUCCESS;
+}
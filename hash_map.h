@@ -0,0 +1,187 @@
+// This header file contains an open-addressing hash map from int keys to ptrs (void*), defined here so
+// that other .c source files can include it. For example, linked_list.c and doubly_linked_list.c use it as an
+// optional index from data to the node holding that data, and cache.c uses it to find cache entries in O(1).
+//
+// Collisions are resolved with Robin Hood hashing: every key sits at most a few slots after its home slot
+// (the slot its hash points to), and on insert, a key that is further from its home slot ("poorer") takes the
+// slot of a key that is closer to its home ("richer"), which then moves on. This keeps probe sequences short
+// and about equally long for all keys, so the map stays fast even when 90% of its slots are in use.
+// Lookups can also stop as soon as they meet a key that is closer to its home than the key being searched
+// would be at that slot: the searched key would have taken that slot on insert, so it is not in the map.
+//
+// Deletion does not leave tombstones behind: the keys after the deleted one are shifted back by one slot
+// until we reach an empty slot or a key that already sits in its home slot (backward-shift deletion).
+//
+// Slot arrays are allocated from hash_map_allocator (see allocator.h), NULL for malloc()/free().
+
+
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "counters.h"
+#include "allocator.h"
+
+#define HASH_MAP_MIN_CAPACITY 16
+#define HASH_MAP_MAX_LOAD_PERCENT 90
+
+// One slot of the map. dist is 0 for an empty slot, otherwise 1 + distance of the slot from the key's home slot
+typedef struct hash_slot {
+    int key;
+    uint32_t dist;
+    void *value;
+} hash_slot;
+
+typedef struct hash_map {
+    hash_slot *slots;
+    uint32_t capacity; // always a power of 2, so that (hash & mask) gives the home slot
+    uint32_t mask;
+    uint32_t size;     // number of keys in the map
+} hash_map;
+
+allocator *hash_map_allocator; // NULL for malloc()/free()
+
+
+// Mix the bits of the key (murmur3 finalizer), so that keys like 0, 1, 2, ... do not cluster
+uint32_t hash_int(int key) {
+    uint32_t h = (uint32_t)key;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+
+// Allocate an empty slot array with the given capacity (a power of 2)
+void hash_map_alloc(hash_map *map, uint32_t capacity) {
+    map->slots = (hash_slot*)ds_alloc(hash_map_allocator, sizeof(hash_slot) * capacity);
+    memset(map->slots, 0, sizeof(hash_slot) * capacity); // dist = 0, i.e. every slot empty
+    map->capacity = capacity;
+    map->mask = capacity - 1;
+    map->size = 0;
+}
+
+
+// Initialize an empty map
+void hash_map_init(hash_map *map) {
+    hash_map_alloc(map, HASH_MAP_MIN_CAPACITY);
+}
+
+
+// Free the slot array. Values are not owned by the map and are not freed
+void hash_map_free(hash_map *map) {
+    ds_free(hash_map_allocator, map->slots, sizeof(hash_slot) * map->capacity);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->mask = 0;
+    map->size = 0;
+}
+
+
+// Remove all keys, keeping the slot array
+void hash_map_clear(hash_map *map) {
+    memset(map->slots, 0, sizeof(hash_slot) * map->capacity);
+    map->size = 0;
+}
+
+
+// Return index of the slot holding key, or -1 if key is not in the map
+int64_t hash_map_find_slot(hash_map *map, int key) {
+    uint32_t i = hash_int(key) & map->mask;
+    COUNT(hash_lookups);
+    for (uint32_t dist = 1; ; dist++) {
+        hash_slot *s = &map->slots[i];
+        COUNT(hash_probes);
+        if (s->dist < dist) return -1; // empty slot, or a richer key: key would have been placed here
+        if (s->key == key) return i;
+        i = (i + 1) & map->mask;
+    }
+}
+
+
+// Place a key that is not in the map yet, Robin Hood style. The map must have a free slot
+void hash_map_place(hash_map *map, int key, void *value) {
+    hash_slot carried = {key, 1, value};
+    uint32_t i = hash_int(key) & map->mask;
+    while (true) {
+        hash_slot *s = &map->slots[i];
+        if (s->dist == 0) {
+            *s = carried;
+            map->size++;
+            return;
+        }
+        if (s->dist < carried.dist) { // s is richer than the key we carry: take its slot and carry it on
+            hash_slot temp = *s;
+            *s = carried;
+            carried = temp;
+        }
+        i = (i + 1) & map->mask;
+        carried.dist++;
+    }
+}
+
+
+// Make room for at least n keys without growing again
+void hash_map_reserve(hash_map *map, uint32_t n) {
+    uint32_t capacity = map->capacity;
+    while ((uint64_t)n * 100 > (uint64_t)capacity * HASH_MAP_MAX_LOAD_PERCENT) capacity *= 2;
+    if (capacity == map->capacity) return;
+
+    hash_map old = *map;
+    hash_map_alloc(map, capacity);
+    for (uint32_t i = 0; i < old.capacity; i++) {
+        if (old.slots[i].dist != 0) hash_map_place(map, old.slots[i].key, old.slots[i].value);
+    }
+    ds_free(hash_map_allocator, old.slots, sizeof(hash_slot) * old.capacity);
+}
+
+
+// Insert key with value, or replace the value if key is already in the map
+void hash_map_put(hash_map *map, int key, void *value) {
+    int64_t i = hash_map_find_slot(map, key);
+    if (i >= 0) {
+        map->slots[i].value = value;
+        return;
+    }
+    hash_map_reserve(map, map->size + 1);
+    hash_map_place(map, key, value);
+}
+
+
+// Look up key. Returns true and sets *value if key is in the map, false otherwise
+bool hash_map_get(hash_map *map, int key, void **value) {
+    int64_t i = hash_map_find_slot(map, key);
+    if (i < 0) return false;
+    if (value != NULL) *value = map->slots[i].value;
+    return true;
+}
+
+
+// Delete key from the map. Returns false if key was not in the map
+bool hash_map_remove(hash_map *map, int key) {
+    int64_t found = hash_map_find_slot(map, key);
+    if (found < 0) return false;
+
+    // Shift the following keys back by one slot, until an empty slot or a key in its home slot (dist == 1)
+    uint32_t i = (uint32_t)found;
+    while (true) {
+        uint32_t next = (i + 1) & map->mask;
+        if (map->slots[next].dist <= 1) {
+            map->slots[i].dist = 0;
+            break;
+        }
+        map->slots[i] = map->slots[next];
+        map->slots[i].dist--;
+        i = next;
+    }
+    map->size--;
+    return true;
+}
+
+#endif
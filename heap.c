@@ -0,0 +1,366 @@
+/*
+Priority Queue - d-ary min-heap, array implementation
+
+A heap is a complete tree stored level by level in an array, in which every node is smaller than or equal
+to its children. So the minimum is always at index 0 and can be read in O(1). In a d-ary heap every node
+has d children: the children of index i are at d*i+1 ... d*i+d, and its parent is at (i-1)/d.
+
+- push: put the new element at the end of the array and move it up (swap with its parent) while it is
+  smaller than its parent. O(log_d n)
+- pop: move the last element to index 0 and move it down (swap with its smallest child) while it is
+  larger than that child. O(d log_d n)
+- heapify: turn an arbitrary array into a heap by moving down every non-leaf node, from the last one
+  to the root. Most nodes are near the bottom and move down only a few levels, so this is O(n), not O(n log n)
+
+Compared to a binary heap (d = 2), a 4-ary heap is half as tall, so push does half as many swaps, and the
+d children of a node sit next to each other in the array (16 bytes of ints for d = 4, inside one cache line),
+so pop's extra comparisons are cheap. Set HEAP_ARITY at compile time (-DHEAP_ARITY=2) to change d.
+
+Compared to the BST, where get_min() is an O(height) walk and there is no extract-min, everything is in
+one contiguous array and the height is always O(log n), whatever the insertion order.
+
+The indexed heap stores ids 0 ... capacity-1 ordered by a key per id, plus the position of every id
+in the heap array. This lets us find an id in the heap in O(1) and change its key with decrease_key()
+in O(log_d n), which is what Dijkstra's algorithm and schedulers that re-prioritize tasks need.
+
+The arrays of both heaps are allocated from heap_allocator (see allocator.h), NULL for malloc()/free().
+
+---IMPLEMENTED OPERATIONS---
+
+1. push
+2. pop - removes the minimum element
+3. _top() - returns the minimum element
+4. is_empty() - returns true if the heap is empty, else false
+5. heapify - build a heap from an array in O(n)
+
+Indexed heap:
+6. push(id, key), pop() - returns the id with the minimum key, contains(id)
+7. decrease_key(id, key)
+
+8. Allocate the arrays from a pluggable allocator (heap_allocator), e.g. a tracking allocator
+9. Top-k largest elements of an array using a heap of size k (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "counters.h"
+#include "allocator.h"
+
+#ifndef HEAP_ARITY
+#define HEAP_ARITY 4
+#endif
+#define HEAP_INITIAL_CAPACITY 16
+
+typedef struct heap {
+    int *arr;
+    int size;
+    int capacity;
+} heap;
+
+allocator *heap_allocator; // NULL for malloc()/free()
+
+
+
+// Initialize an empty heap
+void heap_init(heap *h) {
+    h->arr = (int*)ds_alloc(heap_allocator, sizeof(int) * HEAP_INITIAL_CAPACITY);
+    h->size = 0;
+    h->capacity = HEAP_INITIAL_CAPACITY;
+}
+
+
+// Free the heap's array
+void heap_free(heap *h) {
+    ds_free(heap_allocator, h->arr, sizeof(int) * h->capacity);
+    h->arr = NULL;
+    h->size = 0;
+    h->capacity = 0;
+}
+
+
+// Move the element at index i up until its parent is not larger
+void sift_up(int *arr, int i) {
+    int x = arr[i];
+    while (i > 0) {
+        int parent = (i - 1) / HEAP_ARITY;
+        COUNT(heap_comparisons);
+        if (arr[parent] <= x) break;
+        arr[i] = arr[parent]; // move the parent down instead of swapping, and write x once at the end
+        i = parent;
+    }
+    arr[i] = x;
+}
+
+
+// Move the element at index i down until none of its children is smaller
+void sift_down(int *arr, int size, int i) {
+    int x = arr[i];
+    while (true) {
+        int first_child = HEAP_ARITY * i + 1;
+        if (first_child >= size) break;
+
+        // Find the smallest of the (up to d) children
+        int smallest = first_child;
+        int last_child = first_child + HEAP_ARITY < size ? first_child + HEAP_ARITY : size;
+        COUNT_ADD(heap_comparisons, last_child - first_child); // among the children, then with x
+        for (int c = first_child + 1; c < last_child; c++) {
+            if (arr[c] < arr[smallest]) smallest = c;
+        }
+
+        if (arr[smallest] >= x) break;
+        arr[i] = arr[smallest];
+        i = smallest;
+    }
+    arr[i] = x;
+}
+
+
+// Push element into the heap
+void push(heap *h, int data) {
+    if (h->size == h->capacity) {
+        h->arr = (int*)ds_realloc(heap_allocator, h->arr, sizeof(int) * h->capacity, sizeof(int) * h->capacity * 2);
+        h->capacity *= 2;
+    }
+    h->arr[h->size] = data;
+    sift_up(h->arr, h->size);
+    h->size++;
+}
+
+
+// Pop the minimum element off the heap
+void pop(heap *h) {
+    if (h->size == 0) {
+        printf("Empty heap. Nothing to pop.\n");
+        return;
+    }
+    h->size--;
+    if (h->size > 0) {
+        h->arr[0] = h->arr[h->size];
+        sift_down(h->arr, h->size, 0);
+    }
+}
+
+
+// Return true if heap is empty, false otherwise
+bool is_empty(heap *h) {
+    return h->size == 0;
+}
+
+
+// Return the minimum element
+int _top(heap *h) {
+    if (h->size == 0) {
+        printf("Empty heap. No top element.\n");
+        return -1;
+    }
+    return h->arr[0];
+}
+
+
+// Build a heap from the n elements of arr in O(n). The heap takes a copy of arr
+void heapify(heap *h, int *arr, int n) {
+    h->capacity = n > HEAP_INITIAL_CAPACITY ? n : HEAP_INITIAL_CAPACITY;
+    h->arr = (int*)ds_alloc(heap_allocator, sizeof(int) * h->capacity);
+    for (int i = 0; i < n; i++) h->arr[i] = arr[i];
+    h->size = n;
+    // Leaves are already heaps. Start from the last non-leaf node, the parent of the last element
+    for (int i = (n - 2) / HEAP_ARITY; i >= 0 && n > 1; i--) sift_down(h->arr, n, i);
+}
+
+
+
+// Indexed heap of ids 0 ... capacity-1, ordered by key[id]
+typedef struct iheap {
+    int *heap; // heap[i] is the id at heap index i
+    int *pos;  // pos[id] is the heap index of id, or -1 if id is not in the heap
+    int *key;  // key[id] is the priority of id
+    int size;
+    int capacity;
+} iheap;
+
+
+// Initialize an empty indexed heap for ids 0 ... capacity-1
+void iheap_init(iheap *h, int capacity) {
+    h->heap = (int*)ds_alloc(heap_allocator, sizeof(int) * capacity);
+    h->pos = (int*)ds_alloc(heap_allocator, sizeof(int) * capacity);
+    h->key = (int*)ds_alloc(heap_allocator, sizeof(int) * capacity);
+    for (int id = 0; id < capacity; id++) h->pos[id] = -1;
+    h->size = 0;
+    h->capacity = capacity;
+}
+
+
+// Free the indexed heap's arrays
+void iheap_free(iheap *h) {
+    ds_free(heap_allocator, h->heap, sizeof(int) * h->capacity);
+    ds_free(heap_allocator, h->pos, sizeof(int) * h->capacity);
+    ds_free(heap_allocator, h->key, sizeof(int) * h->capacity);
+    h->size = 0;
+    h->capacity = 0;
+}
+
+
+// Place id at heap index i and record its position
+void iheap_place(iheap *h, int i, int id) {
+    h->heap[i] = id;
+    h->pos[id] = i;
+}
+
+
+// Move the id at heap index i up until its parent's key is not larger
+void iheap_sift_up(iheap *h, int i) {
+    int id = h->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / HEAP_ARITY;
+        COUNT(heap_comparisons);
+        if (h->key[h->heap[parent]] <= h->key[id]) break;
+        iheap_place(h, i, h->heap[parent]);
+        i = parent;
+    }
+    iheap_place(h, i, id);
+}
+
+
+// Move the id at heap index i down until none of its children has a smaller key
+void iheap_sift_down(iheap *h, int i) {
+    int id = h->heap[i];
+    while (true) {
+        int first_child = HEAP_ARITY * i + 1;
+        if (first_child >= h->size) break;
+        int smallest = first_child;
+        int last_child = first_child + HEAP_ARITY < h->size ? first_child + HEAP_ARITY : h->size;
+        COUNT_ADD(heap_comparisons, last_child - first_child); // among the children, then with id's key
+        for (int c = first_child + 1; c < last_child; c++) {
+            if (h->key[h->heap[c]] < h->key[h->heap[smallest]]) smallest = c;
+        }
+        if (h->key[h->heap[smallest]] >= h->key[id]) break;
+        iheap_place(h, i, h->heap[smallest]);
+        i = smallest;
+    }
+    iheap_place(h, i, id);
+}
+
+
+// Return true if id is in the heap
+bool iheap_contains(iheap *h, int id) {
+    return id >= 0 && id < h->capacity && h->pos[id] != -1;
+}
+
+
+// Push id with priority key
+void iheap_push(iheap *h, int id, int key) {
+    if (id < 0 || id >= h->capacity || iheap_contains(h, id)) {
+        printf("Invalid id %d, or id already in the heap.\n", id);
+        return;
+    }
+    h->key[id] = key;
+    iheap_place(h, h->size, id);
+    h->size++;
+    iheap_sift_up(h, h->size - 1);
+}
+
+
+// Pop the id with the minimum key and return it. Returns -1 if the heap is empty
+int iheap_pop(iheap *h) {
+    if (h->size == 0) {
+        printf("Empty heap. Nothing to pop.\n");
+        return -1;
+    }
+    int id = h->heap[0];
+    h->pos[id] = -1;
+    h->size--;
+    if (h->size > 0) {
+        iheap_place(h, 0, h->heap[h->size]);
+        iheap_sift_down(h, 0);
+    }
+    return id;
+}
+
+
+// Lower the key of an id that is in the heap
+void iheap_decrease_key(iheap *h, int id, int key) {
+    if (!iheap_contains(h, id)) {
+        printf("Id %d is not in the heap.\n", id);
+        return;
+    }
+    if (key > h->key[id]) {
+        printf("New key %d is larger than the current key %d of id %d.\n", key, h->key[id], id);
+        return;
+    }
+    h->key[id] = key;
+    iheap_sift_up(h, h->pos[id]);
+}
+
+
+
+// Print the k largest elements of arr, using a min-heap that holds the k largest elements seen so far.
+// O(n log k) time and O(k) extra memory
+void print_top_k(int *arr, int n, int k) {
+    if (k < 1 || n < 1) return;
+    if (k > n) k = n;
+    heap h;
+    heapify(&h, arr, k);
+    for (int i = k; i < n; i++) {
+        if (arr[i] > _top(&h)) { // larger than the smallest of the current top k: replace it
+            h.arr[0] = arr[i];
+            sift_down(h.arr, h.size, 0);
+        }
+    }
+    printf("Top %d elements (ascending):", k);
+    while (!is_empty(&h)) {
+        printf(" %d", _top(&h));
+        pop(&h);
+    }
+    printf("\n");
+    heap_free(&h);
+}
+
+
+
+int main() {
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    heap_allocator = &tracker.base;
+
+    heap h;
+    heap_init(&h);
+
+    int n; // Number of elements to push
+    int x; // Data to push
+    printf("Enter the number of elements you want to push to the heap: ");
+    scanf("%d", &n);
+    int *input = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+    for (int i=0; i<n; i++) {
+        printf("Enter data: ");
+        scanf("%d", &x);
+        push(&h, x);
+        input[i] = x;
+    }
+
+    printf("\nMinimum element: %d\n", _top(&h));
+    printf("Popping minimum element...\n");
+    pop(&h);
+    printf("Minimum element is (if not -1): %d\n", _top(&h));
+    printf("Is the heap empty: %d\n", is_empty(&h));
+    tracking_report(&tracker, "Heap", h.size);
+    counters_print();
+    heap_free(&h);
+    heap_allocator = NULL;
+
+    print_top_k(input, n, 3);
+    free(input);
+
+    // Indexed heap: tasks 0-4 with priorities, then task 3 becomes urgent
+    iheap tasks;
+    iheap_init(&tasks, 5);
+    int priorities[] = {50, 20, 40, 70, 30};
+    for (int id = 0; id < 5; id++) iheap_push(&tasks, id, priorities[id]);
+    iheap_decrease_key(&tasks, 3, 10);
+    printf("Tasks in priority order:");
+    while (tasks.size > 0) printf(" %d", iheap_pop(&tasks));
+    printf("\n");
+    iheap_free(&tasks);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,349 @@
+/*
+Interval tree (augmented AVL tree)
+
+An interval tree stores closed intervals [start, end] (e.g. time ranges) and answers:
+- stabbing queries: which intervals contain the point t?
+- overlap queries: which intervals overlap the interval [a, b]?
+in O(log n + k), where k is the number of intervals reported, instead of an O(n) scan over all intervals.
+
+It is a BST keyed by start (ties broken by end), where every node also stores max_end: the largest end of all
+intervals in its subtree. A query can then skip a whole subtree as soon as its max_end is smaller than the point
+(or the start of the query interval), because none of its intervals reach that far. And, since the tree is
+ordered by start, it can skip the right subtree as soon as the node's start is past the point (or the end of the
+query interval).
+
+This only gives O(log n) if the tree stays balanced. binary_search_tree.c never rebalances, and sorted starts
+(which time ranges usually arrive in) make it a linked list. So this tree is an AVL tree: every node stores its
+height, and insert/delete rotate the nodes on the way back up whenever the heights of two sibling subtrees differ
+by more than 1. A rotation changes the subtrees of exactly two nodes, so it recomputes their heights and max_end,
+lower node first, from their (unchanged) children.
+
+---IMPLEMENTED OPERATIONS---
+1. Insert an interval
+2. Delete an interval
+3. Stabbing query: report all intervals containing a point
+4. Overlap query: report all intervals overlapping an interval
+5. Find number of intervals (size) and height
+6. Check the tree: BST order, AVL balance and max_end values
+7. In-order traversal
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+
+// Interval tree node
+typedef struct node {
+    int start;
+    int end;
+    int max_end; // largest end in the subtree rooted at this node
+    int height;  // height of the subtree rooted at this node (a leaf has height 0)
+    struct node *left;
+    struct node *right;
+} node;
+
+// Called with every interval reported by a query. ctx is passed through from the query
+typedef void (*report_fn)(int start, int end, void *ctx);
+
+// Allocator for the interval tree nodes (NULL for malloc()/free()). Set it before the first insert
+allocator *interval_allocator;
+
+
+
+// Return maximum of 2 integers
+int max(int x, int y) {
+    return (x>=y)?x:y;
+}
+
+
+// Height of a subtree (-1 for an empty one)
+int height(node *root) {
+    return (root == NULL) ? -1 : root->height;
+}
+
+
+// Recompute height and max_end of a node from its children
+void update(node *root) {
+    root->height = 1 + max(height(root->left), height(root->right));
+    root->max_end = root->end;
+    if (root->left != NULL) root->max_end = max(root->max_end, root->left->max_end);
+    if (root->right != NULL) root->max_end = max(root->max_end, root->right->max_end);
+}
+
+
+// Rotate right: the left child of *root becomes the root of the subtree
+void rotate_right(node **root) {
+    node *child = (*root)->left;
+    (*root)->left = child->right;
+    child->right = *root;
+    update(*root); // the old root is now below child, so it is updated first
+    update(child);
+    *root = child;
+}
+
+
+// Rotate left: the right child of *root becomes the root of the subtree
+void rotate_left(node **root) {
+    node *child = (*root)->right;
+    (*root)->right = child->left;
+    child->left = *root;
+    update(*root);
+    update(child);
+    *root = child;
+}
+
+
+// Restore the AVL balance of *root, whose subtrees are balanced but may differ in height by 2, and update it
+void rebalance(node **root) {
+    update(*root);
+    int balance = height((*root)->left) - height((*root)->right);
+    if (balance > 1) {
+        if (height((*root)->left->left) < height((*root)->left->right)) rotate_left(&((*root)->left)); // left-right case
+        rotate_right(root);
+    }
+    else if (balance < -1) {
+        if (height((*root)->right->right) < height((*root)->right->left)) rotate_right(&((*root)->right)); // right-left case
+        rotate_left(root);
+    }
+}
+
+
+// Compare interval [start, end] with the interval of a node, by start, then by end
+int compare(int start, int end, node *root) {
+    if (start != root->start) return (start < root->start) ? -1 : 1;
+    if (end != root->end) return (end < root->end) ? -1 : 1;
+    return 0;
+}
+
+
+// Insert the interval [start, end] (start <= end)
+void insert(node **root, int start, int end) {
+    if (start > end) {
+        printf("Invalid interval [%d, %d]: start is after end\n", start, end);
+        return;
+    }
+    if (*root == NULL) {
+        node *new_node = (node*)ds_alloc(interval_allocator, sizeof(node));
+        new_node->start = start;
+        new_node->end = end;
+        new_node->max_end = end;
+        new_node->height = 0;
+        new_node->left = NULL;
+        new_node->right = NULL;
+        *root = new_node;
+        return;
+    }
+    if (compare(start, end, *root) < 0) insert(&((*root)->left), start, end);
+    else insert(&((*root)->right), start, end); // equal intervals go right
+    rebalance(root);
+}
+
+
+// Unlink the node with the smallest interval from the subtree *root, rebalancing on the way back up. Returns it
+node* unlink_min(node **root) {
+    if ((*root)->left == NULL) {
+        node *min_node = *root;
+        *root = min_node->right;
+        return min_node;
+    }
+    node *min_node = unlink_min(&((*root)->left));
+    rebalance(root);
+    return min_node;
+}
+
+
+// Delete one copy of the interval [start, end]. Returns false if it is not in the tree
+bool delete(node **root, int start, int end) {
+    if (*root == NULL) return false;
+    int cmp = compare(start, end, *root);
+    bool deleted;
+    if (cmp < 0) deleted = delete(&((*root)->left), start, end);
+    else if (cmp > 0) deleted = delete(&((*root)->right), start, end);
+    else {
+        node *del_node = *root;
+        if (del_node->left == NULL) *root = del_node->right;
+        else if (del_node->right == NULL) *root = del_node->left;
+        else {
+            // Replace the node with the smallest interval of its right subtree
+            node *successor = unlink_min(&(del_node->right));
+            successor->left = del_node->left;
+            successor->right = del_node->right;
+            *root = successor;
+        }
+        ds_free(interval_allocator, del_node, sizeof(node));
+        deleted = true;
+    }
+    if (*root != NULL) rebalance(root);
+    return deleted;
+}
+
+
+// Report every interval that overlaps [a, b], i.e. with start <= b and end >= a. Returns the number of intervals reported
+long overlap_query(node *root, int a, int b, report_fn report, void *ctx) {
+    long reported = 0;
+    while (root != NULL) {
+        COUNT(nodes_visited);
+        if (root->max_end < a) break; // no interval in this subtree ends at or after a
+        reported += overlap_query(root->left, a, b, report, ctx);
+        if (root->start > b) break; // this interval, and all intervals in the right subtree, start after b
+        if (root->end >= a) {
+            if (report != NULL) report(root->start, root->end, ctx);
+            reported++;
+        }
+        root = root->right; // loop instead of recursing on the right subtree
+    }
+    return reported;
+}
+
+
+// Report every interval that contains the point t. Returns the number of intervals reported
+long stabbing_query(node *root, int t, report_fn report, void *ctx) {
+    COUNT(searches);
+    return overlap_query(root, t, t, report, ctx);
+}
+
+
+// Get number of intervals in the tree
+int get_size(node **root) {
+    if (*root == NULL) return 0;
+    return 1 + get_size(&((*root)->left)) + get_size(&((*root)->right));
+}
+
+
+// Get height of the tree
+int get_height(node **root) {
+    return height(*root);
+}
+
+
+// Check the subtree root: intervals ordered by start (then end), AVL balanced, heights and max_end correct.
+// All intervals must lie in [lo, hi] (in the order of compare()). Returns true if so
+bool is_interval_tree_utility(node *root, node *lo, node *hi) {
+    if (root == NULL) return true;
+    if (lo != NULL && compare(lo->start, lo->end, root) > 0) return false;
+    if (hi != NULL && compare(hi->start, hi->end, root) < 0) return false;
+    int expected_max_end = root->end;
+    if (root->left != NULL) expected_max_end = max(expected_max_end, root->left->max_end);
+    if (root->right != NULL) expected_max_end = max(expected_max_end, root->right->max_end);
+    if (root->max_end != expected_max_end) return false;
+    if (root->height != 1 + max(height(root->left), height(root->right))) return false;
+    if (abs(height(root->left) - height(root->right)) > 1) return false;
+    return is_interval_tree_utility(root->left, lo, root) && is_interval_tree_utility(root->right, root, hi);
+}
+
+// Check the whole tree, using is_interval_tree_utility()
+bool is_interval_tree(node **root) {
+    return is_interval_tree_utility(*root, NULL, NULL);
+}
+
+
+// In-order traversal (depth-first), printing on one line
+void in_order(node **root) {
+    if (*root == NULL) return;
+    in_order(&((*root)->left));
+    printf(" [%d, %d]", (*root)->start, (*root)->end);
+    in_order(&((*root)->right));
+}
+
+
+// Free all nodes of the tree
+void free_tree(node **root) {
+    if (*root == NULL) return;
+    free_tree(&((*root)->left));
+    free_tree(&((*root)->right));
+    ds_free(interval_allocator, *root, sizeof(node));
+    *root = NULL;
+}
+
+
+// Print a reported interval
+void print_interval(int start, int end, void *ctx) {
+    (void)ctx;
+    printf(" [%d, %d]", start, end);
+}
+
+
+// Benchmark: n time ranges with increasing starts and random lengths, then stabbing queries at random points,
+// answered by the interval tree and by a scan over an array of all intervals
+void compare_with_scan(int n, int queries) {
+    int *starts = (int*)malloc(sizeof(int) * n);
+    int *ends = (int*)malloc(sizeof(int) * n);
+    int *points = (int*)malloc(sizeof(int) * queries);
+    unsigned int state = 2463534242u;
+    node *root = NULL;
+    for (int i = 0; i < n; i++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5; // xorshift32
+        starts[i] = i * 10;
+        ends[i] = starts[i] + (int)(state % 1000);
+        insert(&root, starts[i], ends[i]); // sorted starts: a plain BST would be a linked list
+    }
+    for (int q = 0; q < queries; q++) {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        points[q] = (int)(state % ((unsigned int)n * 10));
+    }
+
+    clock_t start = clock();
+    long tree_found = 0;
+    for (int q = 0; q < queries; q++) tree_found += stabbing_query(root, points[q], NULL, NULL);
+    double tree_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    long scan_found = 0;
+    for (int q = 0; q < queries; q++) {
+        for (int i = 0; i < n; i++) scan_found += (starts[i] <= points[q] && points[q] <= ends[i]);
+    }
+    double scan_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("\n%d stabbing queries over %d intervals (tree height %d): interval tree %.4f s (%ld found), scan %.4f s (%ld found)\n",
+           queries, n, get_height(&root), tree_secs, tree_found, scan_secs, scan_found);
+    free_tree(&root);
+    free(starts);
+    free(ends);
+    free(points);
+}
+
+
+
+int main() {
+    node *root = NULL; // Empty interval tree
+    int n, start, end;
+
+    printf("Enter the number of intervals to insert: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter start and end of interval: ");
+        scanf("%d %d", &start, &end);
+        insert(&root, start, end);
+    }
+
+    insert(&root, 10, 20);
+    insert(&root, 15, 30);
+    insert(&root, 25, 40);
+    insert(&root, 50, 60);
+    insert(&root, 55, 55);
+    printf("\nIntervals:");
+    in_order(&root);
+    printf("\nSize: %d, height: %d, is interval tree: %d\n", get_size(&root), get_height(&root), is_interval_tree(&root));
+
+    printf("Intervals containing 18:");
+    long found = stabbing_query(root, 18, print_interval, NULL);
+    printf(" (%ld)\nIntervals overlapping [35, 52]:", found);
+    found = overlap_query(root, 35, 52, print_interval, NULL);
+    printf(" (%ld)\n", found);
+
+    delete(&root, 15, 30);
+    printf("After deleting [15, 30], intervals containing 18:");
+    stabbing_query(root, 18, print_interval, NULL);
+    printf("\nIs interval tree: %d\n", is_interval_tree(&root));
+
+    free_tree(&root);
+    compare_with_scan(1 << 20, 1000);
+    counters_print();
+
+    return EXIT_SUCCESS;
+}
@@ -45,6 +45,25 @@ so copying pointers (which copies addresses) allows you to access memory locatio
 
 9. Swap data at node positions n and m
 
+10. Save the linked list to a snapshot file, and append the data of a snapshot file (see "snapshot.h")
+
+11. Bulk load data from a file or stdin: run the program with the file name as its argument ("-" for stdin) (see "bulk_load.h")
+
+12. Allocate the nodes from a pluggable allocator (ll_allocator), e.g. a tracking allocator that reports the memory used by the LL (see "allocator.h")
+
+13. Convert to and from a compressed bitmap set of ints (see "roaring.h"), e.g. to keep a large set of ids in a fraction
+of the memory, or to intersect two lists with bitmap operations instead of nested loops. The bitmap is a set: duplicates are
+lost, and the data comes back sorted
+
+14. Optional Bloom filter in front of search_data() (ll_filter, see "bloom.h"), set with ll_set_filter(): every insert adds
+its data to the filter, and a search for data that was never inserted returns NULL without walking the LL. Deletes leave
+their data in the filter, which is still correct but lets more missing data through to the walk
+
+15. Optional hash map index in front of search_data() (ll_index, see "hash_map.h"), set with ll_set_index(): it maps
+every data in the LL to a node holding it, so that search_data() is O(1) expected instead of a walk. Every insert and
+delete keeps it up to date. With duplicate data, the index holds one of the copies, which is not necessarily the first
+one in LL order
+
 
 
 ---EXTRA NOTES--- 
@@ -75,6 +94,15 @@ ends, we will be left with a reversed string.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "snapshot.h"
+#include "bulk_load.h"
+#include "counters.h"
+#include "allocator.h"
+#include "roaring.h"
+#include "bloom.h"
+#include "hash_map.h"
 //#pragma pack(1)
 
 // Node struct
@@ -86,6 +114,48 @@ typedef struct node {
 // Global variable that points to the first LL node
 node *head;
 
+// Allocator for the LL nodes (NULL for malloc()/free()). Set it before the first insert
+allocator *ll_allocator;
+
+// Optional Bloom filter of the data in the LL (NULL for none). Set it with ll_set_filter()
+bloom *ll_filter;
+
+// Optional index from data to a node holding it (NULL for none). Set it with ll_set_index()
+hash_map *ll_index;
+
+// Number of nodes whose data was already indexed when they were inserted (copies the index does not point to)
+int ll_index_duplicates;
+
+
+
+// Add a new node to the index (if any). If its data is already indexed, the node is only counted as a duplicate
+void ll_index_add(node *new_node) {
+    if (ll_index == NULL) return;
+    if (hash_map_get(ll_index, new_node->data, NULL)) ll_index_duplicates++;
+    else hash_map_put(ll_index, new_node->data, new_node);
+}
+
+
+// Drop a node about to be deleted from the index (if any). If it is the indexed node for its data, and the LL has
+// duplicates, walk the LL for another copy of the data and index that one instead. Without duplicates there is no walk
+void ll_index_remove(node *del_node) {
+    if (ll_index == NULL) return;
+    void *indexed;
+    if (!hash_map_get(ll_index, del_node->data, &indexed)) return;
+    if (indexed != del_node) {
+        ll_index_duplicates--;
+        return;
+    }
+    hash_map_remove(ll_index, del_node->data);
+    if (ll_index_duplicates == 0) return;
+    for (node *temp = head; temp != NULL; temp = temp->next) {
+        if (temp != del_node && temp->data == del_node->data) {
+            hash_map_put(ll_index, temp->data, temp);
+            ll_index_duplicates--;
+            return;
+        }
+    }
+}
 
 
 // Print full LL
@@ -134,18 +204,22 @@ void print_data(int n) {
 
 // Insert node at beginning of LL
 void insert_beg (int x) {
-    node* new_node = (node*)malloc(sizeof(node)); // allocate memory for new node
+    node* new_node = (node*)ds_alloc(ll_allocator, sizeof(node)); // allocate memory for new node
     new_node->data = x; // assign data
     new_node->next = head; // assign the next pointer of the new node to head, which is currently pointing to the 1st node
     head = new_node; // reassign head to the address of the new node. head now points to the new node
+    bloom_add(ll_filter, x);
+    ll_index_add(new_node);
 }
 
 
 // Insert node at end of LL
 void insert_end (int x) {
-    node* new_node = (node*)malloc(sizeof(node)); // allocate memory for new node
+    node* new_node = (node*)ds_alloc(ll_allocator, sizeof(node)); // allocate memory for new node
     new_node->data = x; // assign data
     new_node->next = NULL; // assign next pointer to NULL to indicate that this node should be at the end
+    bloom_add(ll_filter, x);
+    ll_index_add(new_node);
 
     if (head == NULL) {
         head = new_node; // if head == NULL, head now points to the new node
@@ -170,8 +244,9 @@ void delete_beg() {
     }
 
     node *temp = head;
+    ll_index_remove(temp);
     head = head->next;
-    free(temp);
+    ds_free(ll_allocator, temp, sizeof(node));
     printf("First node deleted.\n");
 }
 
@@ -183,7 +258,8 @@ void delete_end() {
         return;
     }
     else if (head->next == NULL) { // Edge case when only one node is present
-        free(head);
+        ll_index_remove(head);
+        ds_free(ll_allocator, head, sizeof(node));
         head = NULL;
         printf("Last node deleted.\n");
         return;
@@ -193,8 +269,9 @@ void delete_end() {
     
     while(temp->next->next!=NULL) temp = temp->next; //segfault can happen here. We cannot do temp->next->next if temp->next is itself NULL. So we need to first check for NULL at the first step before checking it at the second step. Or, just add another else if statement like above.
     node *last_node = temp->next;
+    ll_index_remove(last_node);
     temp->next = NULL;
-    free(last_node);
+    ds_free(ll_allocator, last_node, sizeof(node));
 
     printf("Last node deleted.\n");
     // Or we can do this:
@@ -229,8 +306,10 @@ node* get_nodep(int n) {
     // if head != NULL, create new temp node pointer to traverse LL
     int node_count = 0;
     node *temp = head;
+    COUNT(searches);
     while (node_count < n-1) {
         //printf("Data: %d\n", temp->data);
+        COUNT(nodes_visited);
         temp = temp->next;
         if (temp==NULL) {
             printf("LL too small\n");
@@ -269,9 +348,11 @@ void insert_node(int n, int x) {
     }
 
     // create new node, assign it a value, and point it to where the ptr to nth node was pointing
-    node *new_node = (node*)malloc(sizeof(node));
+    node *new_node = (node*)ds_alloc(ll_allocator, sizeof(node));
     new_node->data = x;
     new_node->next = get_nodep(n);
+    bloom_add(ll_filter, x);
+    ll_index_add(new_node);
 
     // Special case when n-1 = 0, because then to make head to point to the new node, we need the ptr to head, which does not exist.
     // Even if we create it, it won't matter, because head would still point to the original node and the LL will stay unchanged
@@ -297,27 +378,40 @@ void delete_node(int n) {
     // special case when the first node is to be deleted. We need to reassign head directly
     if (n==1) {
         node *temp = head;
+        ll_index_remove(temp);
         head = head->next;
-        free(temp);
+        ds_free(ll_allocator, temp, sizeof(node));
         return;
     }
     else {
         node *del_node = get_nodep(n);
+        ll_index_remove(del_node);
         get_nodep(n-1)->next = del_node->next;
-        free(del_node);
+        ds_free(ll_allocator, del_node, sizeof(node));
     }
 }
 
 
-// Linear search a linked list
+// Linear search a linked list. If ll_filter is set, data it has never seen is rejected without walking the LL.
+// If ll_index is set, the node is looked up in it instead of walking the LL
 node* search_data(int data) {
     if (head == NULL) {
         printf("LL empty!\n");
         return NULL;
     }
 
+    COUNT(searches);
+    if (!bloom_maybe_contains(ll_filter, data)) {
+        COUNT(filter_rejections);
+        return NULL;
+    }
+    if (ll_index != NULL) {
+        void *found;
+        return hash_map_get(ll_index, data, &found) ? (node*)found : NULL;
+    }
     node *temp = head;
     while (temp!=NULL) {
+        COUNT(nodes_visited);
         if (temp->data == data) return temp; // return ptr to node if data found
         temp = temp->next;
     }
@@ -326,6 +420,25 @@ node* search_data(int data) {
 }
 
 
+// Put the index index (NULL for none) in front of search_data(), and add the nodes already in the LL to it
+void ll_set_index(hash_map *index) {
+    ll_index = index;
+    ll_index_duplicates = 0;
+    if (index == NULL) return;
+    hash_map_clear(index);
+    hash_map_reserve(index, get_length());
+    for (node *temp = head; temp != NULL; temp = temp->next) ll_index_add(temp);
+}
+
+
+// Put the Bloom filter filter (NULL for none) in front of search_data(), and add the data already in the LL to it
+void ll_set_filter(bloom *filter) {
+    ll_filter = filter;
+    if (filter == NULL) return;
+    for (node *temp = head; temp != NULL; temp = temp->next) bloom_add(filter, temp->data);
+}
+
+
 // Join 2 nodes at start and end positions. Node at start points to node at end to form a loop
 void join_nodes(int start, int end) {
     node *nodep_start = get_nodep(start);
@@ -431,20 +544,170 @@ void swap_data(int n, int m) {
         return;
     }
 
+    node *nodep_n = get_nodep(n);
+    node *nodep_m = get_nodep(m);
+    // Each node now holds the other's data: where the index points to one of them, point it to the other
+    void *indexed;
+    if (ll_index != NULL && nodep_n->data != nodep_m->data) {
+        if (hash_map_get(ll_index, nodep_n->data, &indexed) && indexed == nodep_n) hash_map_put(ll_index, nodep_n->data, nodep_m);
+        if (hash_map_get(ll_index, nodep_m->data, &indexed) && indexed == nodep_m) hash_map_put(ll_index, nodep_m->data, nodep_n);
+    }
     int temp;
-    temp = get_nodep(n)->data;
-    get_nodep(n)->data = get_nodep(m)->data;
-    get_nodep(m)->data = temp;
+    temp = nodep_n->data;
+    nodep_n->data = nodep_m->data;
+    nodep_m->data = temp;
 }
 
 
 
-int main() {
+// Free all nodes, and empty the index (if any)
+void free_LL() {
+    while (head != NULL) {
+        node *next = head->next;
+        ds_free(ll_allocator, head, sizeof(node));
+        head = next;
+    }
+    if (ll_index != NULL) hash_map_clear(ll_index);
+    ll_index_duplicates = 0;
+}
+
+
+
+// Save LL to a snapshot file. Returns true on success
+bool save_LL(const char *path) {
+    int length = get_length();
+    int32_t *data = (int32_t*)malloc(sizeof(int32_t) * (length > 0 ? length : 1));
+    int i = 0;
+    for (node *temp = head; temp != NULL; temp = temp->next) data[i++] = temp->data;
+    bool ok = snapshot_write(path, SNAPSHOT_LIST, SNAPSHOT_NIL, data, length, sizeof(int32_t));
+    free(data);
+    return ok;
+}
+
+
+// Append the data saved in a snapshot file to the end of the LL. The data is read straight from the mapped file.
+// Returns true on success
+bool load_LL(const char *path) {
+    snapshot snap;
+    if (!snapshot_open(&snap, path, SNAPSHOT_LIST, true)) return false;
+
+    // Walk to the last node once, instead of once per element as insert_end() would
+    node *last = head;
+    while (last != NULL && last->next != NULL) last = last->next;
+
+    const int32_t *data = (const int32_t*)snap.payload;
+    for (uint32_t i = 0; i < snap.header->count; i++) {
+        node *new_node = (node*)ds_alloc(ll_allocator, sizeof(node));
+        new_node->data = data[i];
+        new_node->next = NULL;
+        bloom_add(ll_filter, data[i]);
+        ll_index_add(new_node);
+        if (last == NULL) head = new_node;
+        else last->next = new_node;
+        last = new_node;
+    }
+    snapshot_close(&snap);
+    return true;
+}
+
+// Append a batch of bulk-loaded data to the end of the LL. ctx points to a ptr to the last node (NULL if not known yet),
+// so that we walk to the end of the LL only once, not once per element as insert_end() would
+void load_batch(int *batch, int count, void *ctx) {
+    node **last = (node**)ctx;
+    if (*last == NULL) {
+        *last = head;
+        while (*last != NULL && (*last)->next != NULL) *last = (*last)->next;
+    }
+    for (int i = 0; i < count; i++) {
+        node *new_node = (node*)ds_alloc(ll_allocator, sizeof(node));
+        new_node->data = batch[i];
+        new_node->next = NULL;
+        bloom_add(ll_filter, batch[i]);
+        ll_index_add(new_node);
+        if (*last == NULL) head = new_node;
+        else (*last)->next = new_node;
+        *last = new_node;
+    }
+}
+
+
+
+// Add the data of all nodes to the roaring bitmap r (initialized by the caller)
+void LL_to_roaring(roaring *r) {
+    for (node *temp = head; temp != NULL; temp = temp->next) roaring_add(r, temp->data);
+}
+
+
+// Append one value of a roaring bitmap to the end of the LL. ctx points to a ptr to the last node, as in load_batch()
+void append_value(int value, void *ctx) {
+    load_batch(&value, 1, ctx);
+}
+
+// Append all values of the roaring bitmap r to the end of the LL, in increasing order
+void roaring_to_LL(roaring *r) {
+    node *last = NULL;
+    roaring_iterate(r, append_value, &last);
+}
+
+
+
+// Time n_lookups searches (half of them for missing data) in a LL of n nodes, with the linear search_data() and
+// through an index. The LL must be empty, and is left empty
+void compare_lookups(int n, int n_lookups) {
+    hash_map *saved_index = ll_index;
+    bloom *saved_filter = ll_filter;
+    ll_filter = NULL;
+    ll_set_index(NULL);
+    for (int i = 0; i < n; i++) insert_beg(2 * i); // only even data, so odd data are misses
+
+    int found = 0;
+    clock_t start = clock();
+    for (int i = 0; i < n_lookups; i++) found += (search_data(i % (2 * n)) != NULL);
+    double linear_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    hash_map index;
+    hash_map_init(&index);
+    ll_set_index(&index);
+    start = clock();
+    for (int r = 0; r < 1000; r++) {
+        for (int i = 0; i < n_lookups; i++) found += (search_data(i % (2 * n)) != NULL);
+    }
+    double indexed_secs = (double)(clock() - start) / CLOCKS_PER_SEC / 1000;
+
+    printf("%d nodes, %d searches: linear %.6f s, indexed %.6f s (load factor %.2f, %d found)\n",
+           n, n_lookups, linear_secs, indexed_secs, (double)index.size / index.capacity, found);
+    free_LL();
+    ll_set_index(saved_index);
+    ll_filter = saved_filter;
+    hash_map_free(&index);
+}
+
+
+
+int main(int argc, char *argv[]) {
     head = NULL;
+    // Allocate the nodes through a tracking allocator, to see how much memory the LL uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    ll_allocator = &tracker.base;
+    if (argc > 1) {
+        // Bulk load from a file ("-" for stdin) instead of prompting for every element
+        node *last = NULL;
+        long loaded = bulk_load(argv[1], load_batch, &last);
+        printf("Loaded %ld elements. LL has %d nodes\n", loaded, get_length());
+        tracking_report(&tracker, "LL", get_length());
+        counters_print();
+        return loaded < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     int data_elements;
     int x;
     printf("Enter number of elements to add to LL: ");
     scanf("%d", &data_elements);
+    // Bloom filter with a 1% false positive rate, so that searches for missing data mostly skip the walk
+    bloom filter;
+    bloom_init(&filter, &tracker.base, data_elements + 64, 0.01); // counted in the LL's memory report
+    ll_set_filter(&filter);
     for(int i=0; i<data_elements; i++){
         printf("Enter number to add to end of LL: ");
         scanf("%d", &x);
@@ -479,5 +742,43 @@ int main() {
     printLL();
     recursive_reverseLL(head);
     printLL();
+
+    // Save the LL, then append the saved copy to itself
+    if (save_LL("ll_snapshot.bin")) {
+        load_LL("ll_snapshot.bin");
+        printf("LL has %d nodes after appending its snapshot\n", get_length());
+        remove("ll_snapshot.bin");
+    }
+
+    printf("Search for 99: %s. Search for 12345: %s\n", search_data(99) != NULL ? "found" : "not found",
+           search_data(12345) != NULL ? "found" : "not found");
+
+    // Index the LL: searches no longer walk it, and inserts and deletes keep the index up to date
+    hash_map index;
+    hash_map_init(&index);
+    ll_set_index(&index);
+    delete_node(2);
+    node *found = search_data(99);
+    printf("Indexed search for 99: %s. LL has %d nodes, %u distinct data in the index\n",
+           found != NULL ? "found" : "not found", get_length(), index.size);
+
+    // Deduplicate and sort the LL through a roaring bitmap
+    roaring set;
+    roaring_init(&set, NULL);
+    LL_to_roaring(&set);
+    printf("LL has %d nodes, %ld distinct values (%zu bytes as a roaring bitmap)\n", get_length(), roaring_cardinality(&set), roaring_memory(&set));
+    free_LL();
+    roaring_to_LL(&set);
+    roaring_free(&set);
+    printLL();
+    tracking_report(&tracker, "LL", get_length());
+    counters_print();
+    free_LL();
+    ll_set_index(NULL);
+    hash_map_free(&index);
+    ll_set_filter(NULL);
+    bloom_free(&filter);
+
+    compare_lookups(1 << 16, 1000);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
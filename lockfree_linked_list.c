@@ -0,0 +1,412 @@
+/*
+Lock-free sorted linked list (Harris/Michael) - a concurrent ordered set of ints
+
+linked_list.c implements insert_node(), delete_node() and search_data() on a global head, for a single thread.
+Here the same three operations (insert, delete, contains) work on a sorted list that many threads can
+modify at the same time, without locks. Every link update is a single compare-and-swap (CAS).
+
+Why a plain CAS on next is not enough: if thread A inserts a node after node X while thread B deletes X,
+both CAS operations can succeed and A's new node ends up linked from a deleted node, i.e. it is lost.
+Harris' fix is to delete in two steps:
+1. Logical deletion: mark the next ptr of the node being deleted, by setting its lowest bit (nodes are
+   at least 2-byte aligned, so that bit is always 0 in a real address). A CAS expecting an unmarked ptr
+   will now fail, so nobody can link a new node after a deleted one.
+2. Physical deletion: unlink the marked node from its predecessor with another CAS. If that fails,
+   any thread that later walks past the marked node unlinks it (see find()).
+
+Safe memory reclamation: after a node is unlinked, other threads might still be reading it, so we cannot
+free() it right away. We use hazard pointers (Michael, 2004). Before dereferencing a node, a thread publishes
+its address in one of its hazard pointer slots and re-checks that the node is still linked. An unlinked node
+is put on the thread's retired list, and the retired list is scanned once it gets long: nodes that no
+thread has published in a hazard slot are freed, the others are kept for the next scan.
+
+Each thread must call lf_thread_enter() before its first operation and lf_thread_exit() when it is done.
+
+Nodes are allocated from lf_allocator (see allocator.h), NULL for malloc()/free(). A node can be freed by a different
+thread than the one that allocated it, so the allocator must be thread-safe while several threads use the set.
+The tracking and arena allocators are not, so main() only uses a tracking allocator for the single-threaded part.
+
+Compile with: gcc -std=c11 -O2 -pthread lockfree_linked_list.c
+
+---IMPLEMENTED OPERATIONS---
+
+1. Insert (returns false if the key is already in the set)
+2. Delete (returns false if the key is not in the set)
+3. Contains
+4. Print the set and count its keys (only safe while no other thread is modifying it)
+5. Allocator interface: nodes come from lf_allocator
+6. Multi-threaded benchmark with mixed read/write ratios (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+
+#define MAX_THREADS 64
+#define HP_PER_THREAD 2 // slot 0 protects the current node, slot 1 protects the node before it
+#define RETIRE_THRESHOLD (2 * MAX_THREADS * HP_PER_THREAD)
+
+#define MARK 1
+#define IS_MARKED(p) (((p) & MARK) != 0)
+#define UNMARKED(p) ((p) & ~(uintptr_t)MARK)
+
+// List node. next holds the address of the next node, with the lowest bit used as the deletion mark
+typedef struct node {
+    int data;
+    _Atomic(uintptr_t) next;
+} node;
+
+// Concurrent set handle. head is never marked
+typedef struct lf_set {
+    _Atomic(uintptr_t) head;
+} lf_set;
+
+// Hazard pointer slots of one thread, on their own cache line so threads do not slow each other down
+typedef struct hp_record {
+    _Atomic(node*) hp[HP_PER_THREAD];
+    atomic_bool in_use;
+    char pad[64 - HP_PER_THREAD * sizeof(node*) - sizeof(atomic_bool)];
+} hp_record;
+
+_Alignas(64) hp_record hp_records[MAX_THREADS];
+
+allocator *lf_allocator; // NULL for malloc()/free(). Must be thread-safe while several threads use a set
+
+// Per-thread state: index of our hazard pointer record, and the nodes we unlinked but could not free yet
+_Thread_local int thread_slot = -1;
+_Thread_local node *retired[RETIRE_THRESHOLD];
+_Thread_local int retired_count = 0;
+
+
+
+// Claim a hazard pointer record for the calling thread
+void lf_thread_enter() {
+    for (int i = 0; i < MAX_THREADS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&hp_records[i].in_use, &expected, true)) {
+            thread_slot = i;
+            return;
+        }
+    }
+    printf("More than %d threads are using lock-free lists. Aborting.\n", MAX_THREADS);
+    abort();
+}
+
+
+// Compare function for qsort()/bsearch() on node ptrs
+int compare_ptrs(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)*(node* const*)a, y = (uintptr_t)*(node* const*)b;
+    return (x > y) - (x < y);
+}
+
+
+// Free every retired node that is not published in any thread's hazard pointer slot
+void scan_retired() {
+    node *hazards[MAX_THREADS * HP_PER_THREAD];
+    int num_hazards = 0;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        for (int j = 0; j < HP_PER_THREAD; j++) {
+            node *p = atomic_load(&hp_records[i].hp[j]);
+            if (p != NULL) hazards[num_hazards++] = p;
+        }
+    }
+    qsort(hazards, num_hazards, sizeof(node*), compare_ptrs);
+
+    int kept = 0;
+    for (int i = 0; i < retired_count; i++) {
+        if (bsearch(&retired[i], hazards, num_hazards, sizeof(node*), compare_ptrs) != NULL) retired[kept++] = retired[i];
+        else ds_free(lf_allocator, retired[i], sizeof(node));
+    }
+    retired_count = kept;
+}
+
+
+// Hand over an unlinked node for freeing once no thread can be reading it anymore
+void retire(node *del_node) {
+    retired[retired_count++] = del_node;
+    if (retired_count == RETIRE_THRESHOLD) scan_retired();
+}
+
+
+// Free all our retired nodes and release our hazard pointer record
+void lf_thread_exit() {
+    for (int j = 0; j < HP_PER_THREAD; j++) atomic_store(&hp_records[thread_slot].hp[j], NULL);
+    // Other threads only hold hazard pointers for the duration of one operation, so this loop ends quickly
+    while (retired_count > 0) {
+        scan_retired();
+        if (retired_count > 0) sched_yield();
+    }
+    atomic_store(&hp_records[thread_slot].in_use, false);
+    thread_slot = -1;
+}
+
+
+// Clear our hazard pointers at the end of an operation
+void clear_hazards() {
+    for (int j = 0; j < HP_PER_THREAD; j++) atomic_store(&hp_records[thread_slot].hp[j], NULL);
+}
+
+
+// Initialize an empty set
+void lf_init(lf_set *set) {
+    atomic_init(&set->head, (uintptr_t)NULL);
+}
+
+
+// Find the first node with data >= key. On return, *prev is the link that points to it (cur), cur is protected
+// by hazard slot 0 and the node owning *prev (if any) by hazard slot 1. Marked nodes found on the way are unlinked.
+// Returns true if cur holds key
+bool find(lf_set *set, int key, _Atomic(uintptr_t) **pprev, node **pcur, uintptr_t *pnext) {
+    hp_record *rec = &hp_records[thread_slot];
+    COUNT(searches);
+retry:;
+    _Atomic(uintptr_t) *prev = &set->head;
+    node *cur = (node*)atomic_load(prev);
+    while (true) {
+        if (cur == NULL) {
+            *pprev = prev;
+            *pcur = NULL;
+            *pnext = (uintptr_t)NULL;
+            return false;
+        }
+
+        // Publish cur, then check it is still linked from prev. After that, it cannot be freed under us
+        atomic_store(&rec->hp[0], cur);
+        if (atomic_load(prev) != (uintptr_t)cur) goto retry;
+
+        COUNT(nodes_visited); // counted again if a retry reads it a second time
+        uintptr_t next = atomic_load(&cur->next);
+        if (IS_MARKED(next)) {
+            // cur is logically deleted: help by unlinking it. If prev changed in the meantime, start over
+            uintptr_t expected = (uintptr_t)cur;
+            if (!atomic_compare_exchange_strong(prev, &expected, UNMARKED(next))) goto retry;
+            retire(cur);
+            cur = (node*)UNMARKED(next);
+            continue;
+        }
+
+        int cur_data = cur->data;
+        if (atomic_load(prev) != (uintptr_t)cur) goto retry;
+        if (cur_data >= key) {
+            *pprev = prev;
+            *pcur = cur;
+            *pnext = next;
+            return cur_data == key;
+        }
+
+        // Move one node forward. cur becomes the node owning prev, so it moves to hazard slot 1
+        prev = &cur->next;
+        atomic_store(&rec->hp[1], cur);
+        cur = (node*)next;
+    }
+}
+
+
+// Insert key into the set. Returns false if it was already there
+bool lf_insert(lf_set *set, int key) {
+    node *new_node = (node*)ds_alloc(lf_allocator, sizeof(node));
+    new_node->data = key;
+
+    _Atomic(uintptr_t) *prev;
+    node *cur;
+    uintptr_t next;
+    while (true) {
+        if (find(set, key, &prev, &cur, &next)) {
+            ds_free(lf_allocator, new_node, sizeof(node)); // never published, so it can be freed directly
+            clear_hazards();
+            return false;
+        }
+        atomic_store(&new_node->next, (uintptr_t)cur);
+        uintptr_t expected = (uintptr_t)cur;
+        if (atomic_compare_exchange_strong(prev, &expected, (uintptr_t)new_node)) {
+            clear_hazards();
+            return true;
+        }
+    }
+}
+
+
+// Delete key from the set. Returns false if it was not there
+bool lf_delete(lf_set *set, int key) {
+    _Atomic(uintptr_t) *prev;
+    node *cur;
+    uintptr_t next;
+    while (true) {
+        if (!find(set, key, &prev, &cur, &next)) {
+            clear_hazards();
+            return false;
+        }
+
+        // Step 1: logical deletion. Fails if cur->next changed or someone else marked it first
+        uintptr_t expected = next;
+        if (!atomic_compare_exchange_strong(&cur->next, &expected, next | MARK)) continue;
+
+        // Step 2: physical deletion. If it fails, find() unlinks cur for us
+        expected = (uintptr_t)cur;
+        if (atomic_compare_exchange_strong(prev, &expected, next)) retire(cur);
+        else find(set, key, &prev, &cur, &next);
+        clear_hazards();
+        return true;
+    }
+}
+
+
+// Return true if key is in the set
+bool lf_contains(lf_set *set, int key) {
+    _Atomic(uintptr_t) *prev;
+    node *cur;
+    uintptr_t next;
+    bool found = find(set, key, &prev, &cur, &next);
+    clear_hazards();
+    return found;
+}
+
+
+// Print the set. Only safe while no other thread is modifying it
+void lf_print(lf_set *set) {
+    node *temp = (node*)atomic_load(&set->head);
+    if (temp == NULL) {
+        printf("Set is empty!\n");
+        return;
+    }
+    printf("\n--Start set--\n");
+    while (temp != NULL) {
+        uintptr_t next = atomic_load(&temp->next);
+        if (!IS_MARKED(next)) printf("Data: %d\n", temp->data);
+        temp = (node*)UNMARKED(next);
+    }
+    printf("--End set--\n\n");
+}
+
+
+// Return the number of keys in the set. Only safe while no other thread is modifying it
+int lf_size(lf_set *set) {
+    int size = 0;
+    for (node *temp = (node*)atomic_load(&set->head); temp != NULL; temp = (node*)UNMARKED(atomic_load(&temp->next))) {
+        if (!IS_MARKED(atomic_load(&temp->next))) size++;
+    }
+    return size;
+}
+
+
+// Free all nodes. Only safe once no other thread uses the set
+void lf_destroy(lf_set *set) {
+    node *temp = (node*)atomic_load(&set->head);
+    while (temp != NULL) {
+        node *next = (node*)UNMARKED(atomic_load(&temp->next));
+        ds_free(lf_allocator, temp, sizeof(node));
+        temp = next;
+    }
+    atomic_store(&set->head, (uintptr_t)NULL);
+}
+
+
+
+// Benchmark: each thread runs ops_per_thread random operations on keys in [0, key_range),
+// contains_percent of them lookups and the rest split evenly between inserts and deletes
+typedef struct bench_args {
+    lf_set *set;
+    int key_range;
+    int contains_percent;
+    long ops_per_thread;
+    unsigned int seed;
+} bench_args;
+
+
+// xorshift32 random number generator, so threads do not contend on the shared state of rand()
+unsigned int next_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+void* bench_worker(void *arg) {
+    bench_args *args = (bench_args*)arg;
+    unsigned int state = args->seed;
+    lf_thread_enter();
+    for (long i = 0; i < args->ops_per_thread; i++) {
+        int key = next_random(&state) % args->key_range;
+        int op = next_random(&state) % 100;
+        if (op < args->contains_percent) lf_contains(args->set, key);
+        else if ((op - args->contains_percent) % 2 == 0) lf_insert(args->set, key);
+        else lf_delete(args->set, key);
+    }
+    lf_thread_exit();
+    return NULL;
+}
+
+
+// Run the benchmark with num_threads threads and print the throughput
+void run_benchmark(int num_threads, int contains_percent, int key_range, long ops_per_thread) {
+    lf_set set;
+    lf_init(&set);
+    lf_thread_enter();
+    for (int k = 0; k < key_range; k += 2) lf_insert(&set, k); // start half full
+    lf_thread_exit();
+
+    pthread_t threads[MAX_THREADS];
+    bench_args args[MAX_THREADS];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < num_threads; t++) {
+        args[t] = (bench_args){&set, key_range, contains_percent, ops_per_thread, 2463534242u + 7919u * t};
+        pthread_create(&threads[t], NULL, bench_worker, &args[t]);
+    }
+    for (int t = 0; t < num_threads; t++) pthread_join(threads[t], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("threads: %2d, contains/insert/delete: %3d/%3d/%3d %%, throughput: %.2f Mops/s\n",
+           num_threads, contains_percent, (100 - contains_percent) / 2, (100 - contains_percent) / 2,
+           num_threads * ops_per_thread / secs / 1e6);
+    lf_destroy(&set);
+}
+
+
+
+int main() {
+    // Single-threaded part: the tracking allocator is not thread-safe, so the benchmark below goes back to malloc()
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    lf_allocator = &tracker.base;
+
+    lf_set set;
+    lf_init(&set);
+    lf_thread_enter();
+
+    int n, x;
+    printf("Enter the number of elements to add to the set: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter number to add: ");
+        scanf("%d", &x);
+        if (!lf_insert(&set, x)) printf("%d is already in the set\n", x);
+    }
+    lf_insert(&set, 99);
+    lf_print(&set);
+    bool deleted = lf_delete(&set, 99);
+    printf("Delete 99: %d, contains 99: %d\n", deleted, lf_contains(&set, 99));
+    lf_thread_exit(); // frees the retired node of 99
+    tracking_report(&tracker, "Lock-free set", lf_size(&set));
+    counters_print();
+    lf_destroy(&set);
+    lf_allocator = NULL;
+
+    int thread_counts[] = {1, 2, 4, 8};
+    int contains_percents[] = {90, 50, 0};
+    for (int m = 0; m < 3; m++) {
+        for (int t = 0; t < 4; t++) run_benchmark(thread_counts[t], contains_percents[m], 1024, 50000);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+/*
+Persistent binary search tree (path copying)
+
+In binary_search_tree.c, insert() modifies the tree in place, so a long scan (e.g. an in-order traversal)
+that runs while inserts continue can see a mix of old and new keys. In a persistent BST, no node is ever
+modified after it is created. Instead, insert() returns the root of a new version of the tree, and every
+old root stays a valid, unchanging version:
+- insert copies only the nodes on the path from the root to the place where the new node goes (path copying).
+  Every copy points to the same untouched subtrees as the original node, so the new version shares all other
+  nodes with the old one, and each insert allocates only O(height) nodes, O(log n) for a balanced tree
+- a snapshot is just a ptr to a version's root: taking one is O(1) and never has to wait for, or stop, inserts
+
+Since nodes are shared between versions, a node can only be freed when no version uses it anymore. Every
+node has a reference count: the number of parent nodes plus version handles pointing to it. release()
+drops a version, decrements the counts and frees the nodes that are no longer used by any version.
+The counts are atomic, so a snapshot can be scanned and released on another thread than the one inserting.
+The thread that inserts should also be the one that hands out snapshots of the latest version.
+
+Nodes are allocated from pbst_allocator (see allocator.h), NULL for malloc()/free(). If versions are released on
+other threads, that allocator must be thread-safe (the tracking and arena allocators are not).
+
+Insertion follows binary_search_tree.c: data less than or equal to a node's data goes to its left subtree.
+
+---IMPLEMENTED OPERATIONS---
+1. Insert, returning a new version
+2. Take a snapshot of a version (O(1))
+3. Release a version
+4. Search
+5. Find number of elements (size) and height
+6. In-order traversal
+7. Allocate the nodes from a pluggable allocator (pbst_allocator), e.g. a tracking allocator
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "counters.h"
+#include "allocator.h"
+
+// Persistent BST node. Immutable after creation, except for the reference count
+typedef struct node {
+    int data;
+    struct node *left;
+    struct node *right;
+    atomic_int refcount;
+} node;
+
+// Number of nodes currently allocated, over all versions
+atomic_long live_nodes;
+
+allocator *pbst_allocator; // NULL for malloc()/free()
+
+
+
+// Create a new BST node, owned by the caller (reference count 1)
+node* create(int data, node *left, node *right) {
+    node* new_node = (node*)ds_alloc(pbst_allocator, sizeof(node));
+    new_node->data = data;
+    new_node->left = left;
+    new_node->right = right;
+    atomic_init(&new_node->refcount, 1);
+    atomic_fetch_add(&live_nodes, 1);
+    return new_node;
+}
+
+
+// Add a reference to a node (or version root)
+node* retain(node *root) {
+    if (root != NULL) atomic_fetch_add(&root->refcount, 1);
+    return root;
+}
+
+
+// Drop a reference to a version root or node. Frees the node, and releases its children, once nobody uses it
+void release(node *root) {
+    while (root != NULL) {
+        if (atomic_fetch_sub(&root->refcount, 1) != 1) return; // still used by another version or parent
+        release(root->left);
+        node *right = root->right;
+        ds_free(pbst_allocator, root, sizeof(node));
+        atomic_fetch_sub(&live_nodes, 1);
+        root = right; // loop instead of recursing on the right subtree
+    }
+}
+
+
+// Take a snapshot of a version in O(1). The caller must release() it when done
+node* snapshot(node *root) {
+    return retain(root);
+}
+
+
+// Copy a node. The copy shares (and so holds a reference to) both subtrees of the original
+node* copy_node(node *original) {
+    return create(original->data, retain(original->left), retain(original->right));
+}
+
+
+// Insert data into the version rooted at root and return the root of the new version, owned by the caller.
+// The old version is left unchanged and still has to be released by its owner
+node* insert(node *root, int data) {
+    COUNT(bst_inserts);
+    if (root == NULL) return create(data, NULL, NULL);
+
+    node *new_root = copy_node(root);
+    node *cur = new_root;
+    while (true) {
+        COUNT(bst_insert_comparisons);
+        node **child = (data <= cur->data) ? &cur->left : &cur->right;
+        if (*child == NULL) {
+            *child = create(data, NULL, NULL);
+            break;
+        }
+        node *copy = copy_node(*child);
+        release(*child); // cur now points to the copy, not to the original child (which the old version still holds)
+        *child = copy;
+        cur = copy;
+    }
+    return new_root;
+}
+
+
+// Search for data in a version. Returns true if found
+bool search(node *root, int data) {
+    COUNT(searches);
+    while (root != NULL) {
+        COUNT(nodes_visited);
+        if (data == root->data) return true;
+        root = (data < root->data) ? root->left : root->right;
+    }
+    return false;
+}
+
+
+// Get number of elements in a version
+int get_size(node *root) {
+    if (root == NULL) return 0;
+    return 1 + get_size(root->left) + get_size(root->right);
+}
+
+
+// Return maximum of 2 integers
+int max(int x, int y) {
+    return (x>=y)?x:y;
+}
+
+
+// Get height of a version
+int get_height(node *root) {
+    if (root == NULL) return -1;
+    return 1 + max(get_height(root->left), get_height(root->right));
+}
+
+
+// In-order traversal (depth-first), printing on one line
+void in_order(node *root) {
+    if (root == NULL) return;
+    in_order(root->left);
+    printf(" %d", root->data);
+    in_order(root->right);
+}
+
+
+
+int main() {
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    pbst_allocator = &tracker.base;
+
+    node *root = NULL; // Current version. NULL is the empty tree
+    int n, x;
+
+    printf("Enter the number of elements to insert: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter number to insert: ");
+        scanf("%d", &x);
+        node *new_root = insert(root, x);
+        release(root); // we only keep the latest version here
+        root = new_root;
+    }
+
+    // Take a snapshot, then keep inserting into the current version
+    node *snap = snapshot(root);
+    long nodes_before = atomic_load(&live_nodes);
+    for (int i = 0; i < 3; i++) {
+        node *new_root = insert(root, 100 + i);
+        release(root);
+        root = new_root;
+    }
+
+    printf("\nSnapshot (size %d):", get_size(snap));
+    in_order(snap);
+    printf("\nCurrent version (size %d):", get_size(root));
+    in_order(root);
+    printf("\nNet nodes added by 3 inserts while the snapshot is alive: %ld (height of current version: %d)\n",
+           atomic_load(&live_nodes) - nodes_before, get_height(root));
+    printf("Is 101 in the snapshot? %d. In the current version? %d\n", search(snap, 101), search(root, 101));
+    tracking_report(&tracker, "Snapshot + current version", get_size(root));
+    counters_print();
+
+    release(snap);
+    release(root);
+    printf("Nodes left after releasing all versions: %ld\n", atomic_load(&live_nodes));
+    pbst_allocator = NULL;
+
+    return EXIT_SUCCESS;
+}
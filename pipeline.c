@@ -0,0 +1,148 @@
+/*
+Pipeline executor - stages running in worker threads, connected by blocking queues
+
+Processing is often a chain of stages: parse the input, filter it, aggregate what is left. Running the chain in one
+thread leaves the other cores idle, and hand-wiring threads around queues means writing the batching, the waiting
+on full and empty queues, and the shutdown (who closes what, when) again for every chain. pipeline.h does it once:
+declare every stage with its function and number of worker threads, push items, and finish.
+
+The executor is implemented in the header file pipeline.h, on top of the blocking queue of blocking_queue.h.
+
+Compile with: gcc -std=c11 -O2 -pthread pipeline.c
+
+---IMPLEMENTED OPERATIONS---
+
+1. Declare stages with a function and a number of worker threads (pipeline_add_stage)
+2. Start the workers, push items, and shut down once every item has gone through (pipeline_start, pipeline_push, pipeline_finish)
+3. Ordered mode: every stage sees the items in the order they were pushed. Unordered mode: workers do not wait for each other
+4. Batching and backpressure between stages (bounded queues of batches)
+5. Per-stage stats: items in and out, items/s, busy share of the workers, queue depth (pipeline_print_stats)
+
+Below, a parse -> filter -> aggregate chain over numbers given as strings: parse them, keep the primes, and sum them.
+It runs in one thread, and as an ordered and an unordered pipeline (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "pipeline.h"
+
+// State of the aggregate stage
+typedef struct aggregate {
+    long long sum;
+    long count;
+    long last;     // last value seen
+    bool in_order; // whether the values arrived in increasing order
+} aggregate;
+
+
+
+// Parse stage: string -> int (stored in the ptr)
+bool parse(void *item, void **out, void *ctx) {
+    (void)ctx;
+    *out = (void*)(intptr_t)strtol((const char*)item, NULL, 10);
+    return true;
+}
+
+
+// Return true if x is prime (trial division: deliberately slow, so that the filter stage is the expensive one)
+bool is_prime(long x) {
+    if (x < 2) return false;
+    for (long d = 2; d * d <= x; d++) {
+        if (x % d == 0) return false;
+    }
+    return true;
+}
+
+
+// Filter stage: keep the primes
+bool keep_primes(void *item, void **out, void *ctx) {
+    (void)ctx;
+    *out = item;
+    return is_prime((intptr_t)item);
+}
+
+
+// Aggregate stage (one worker): sum the values and check their order
+bool sum_values(void *item, void **out, void *ctx) {
+    aggregate *a = (aggregate*)ctx;
+    long value = (long)(intptr_t)item;
+    if (a->count > 0 && value < a->last) a->in_order = false;
+    a->last = value;
+    a->sum += value;
+    a->count++;
+    *out = item;
+    return true;
+}
+
+
+// Print the result of the aggregate stage
+void print_aggregate(const char *name, aggregate *a, double secs) {
+    printf("%-20s %.3f s: %ld primes, sum %lld, in order: %s\n", name, secs, a->count, a->sum, a->in_order ? "yes" : "no");
+}
+
+
+// Run the chain over the n strings in input: in one thread, then as ordered and unordered pipelines with filter_workers
+// workers in the filter stage
+void compare_pipelines(char **input, int n, int filter_workers) {
+    aggregate single = {0, 0, 0, true};
+    double start = pipeline_now();
+    for (int i = 0; i < n; i++) {
+        void *value, *out;
+        parse(input[i], &value, NULL);
+        if (keep_primes(value, &out, NULL)) sum_values(out, &out, &single);
+    }
+    print_aggregate("\nOne thread:", &single, pipeline_now() - start);
+
+    for (int ordered = 1; ordered >= 0; ordered--) {
+        aggregate result = {0, 0, 0, true};
+        pipeline p;
+        pipeline_init(&p, ordered, 16);
+        pipeline_add_stage(&p, "parse", parse, NULL, 1);
+        pipeline_add_stage(&p, "filter", keep_primes, NULL, filter_workers);
+        pipeline_add_stage(&p, "aggregate", sum_values, &result, 1);
+        pipeline_start(&p);
+        for (int i = 0; i < n; i++) pipeline_push(&p, input[i]);
+        pipeline_finish(&p);
+        print_aggregate(ordered ? "Ordered pipeline:" : "Unordered pipeline:", &result, p.end_time - p.start_time);
+        pipeline_print_stats(&p);
+        pipeline_destroy(&p);
+    }
+}
+
+
+
+int main() {
+    int n;
+    printf("Enter the number of numbers to run through the pipeline: ");
+    scanf("%d", &n);
+    if (n < 0) n = 0;
+
+    // The numbers 0..n-1 as strings, so that the pipeline starts with a parse stage
+    char **input = (char**)malloc(sizeof(char*) * (n > 0 ? n : 1));
+    char *text = (char*)malloc(12 * (size_t)(n > 0 ? n : 1));
+    for (int i = 0; i < n; i++) {
+        input[i] = text + 12 * (size_t)i;
+        snprintf(input[i], 12, "%d", i);
+    }
+    compare_pipelines(input, n, 4);
+    free(input);
+    free(text);
+
+    // Benchmark input: 2^20 large numbers, so that the filter stage dominates
+    n = 1 << 20;
+    input = (char**)malloc(sizeof(char*) * n);
+    text = (char*)malloc(12 * (size_t)n);
+    for (int i = 0; i < n; i++) {
+        input[i] = text + 12 * (size_t)i;
+        snprintf(input[i], 12, "%d", 1000000000 + i);
+    }
+    compare_pipelines(input, n, 4);
+    free(input);
+    free(text);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,272 @@
+// This header file contains a pipeline executor: a chain of stages, each run by its own worker threads, connected by
+// blocking bounded queues (blocking_queue.h). It is defined here so that other .c source files can include it.
+// pipeline.c uses it for a parse -> filter -> aggregate chain.
+//
+// A stage is a function from one item (void*) to one output item, which can also drop the item (a filter). The
+// items pushed into the pipeline go through every stage in order, and the last stage's output is discarded, so the
+// last stage is usually a sink that aggregates into its ctx.
+//
+// - Batching: items travel between stages in batches of up to PIPELINE_BATCH items, so a queue push or pop (a lock,
+//   maybe a wake-up) is paid once per batch instead of once per item.
+// - Parallelism: every stage has its own number of worker threads, so a slow stage can get more of them.
+// - Backpressure: the queues are bounded. When a stage falls behind, its input queue fills up and the stage before
+//   it (and finally pipeline_push()) waits, instead of piling up items in memory.
+// - Ordered mode: with several workers, batches can overtake each other. In ordered mode, every batch gets a sequence
+//   number at the source, and the workers of a stage hand their batches to the next stage strictly in sequence order,
+//   so every stage (e.g. an aggregation that needs the original order) sees the items in the order they were pushed.
+//   Unordered mode skips this and lets a fast worker go ahead.
+// - Shutdown: pipeline_finish() flushes the last partial batch and closes the first queue. The workers of a stage
+//   drain their queue and exit, and the last one to exit closes the next stage's queue, so every item pushed before
+//   pipeline_finish() goes through every stage before the threads are joined.
+// - Stats: per stage, items in and out, time spent in the stage function, and the depth of its input queue.
+//
+// Compile with -pthread.
+
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include "blocking_queue.h"
+
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_MAX_WORKERS 16 // per stage
+#define PIPELINE_BATCH 64       // items per batch
+
+// Stage function: process item and set *out to the item for the next stage. Return false to drop the item.
+// ctx is the ptr given to pipeline_add_stage(). With more than one worker, it is called from several threads at once
+typedef bool (*stage_fn)(void *item, void **out, void *ctx);
+
+// Batch of items travelling between stages
+typedef struct pipeline_batch {
+    long seq; // position of the batch in the input (ordered mode)
+    int count;
+    void *items[PIPELINE_BATCH];
+} pipeline_batch;
+
+struct pipeline;
+
+typedef struct pipeline_stage {
+    const char *name;
+    stage_fn fn;
+    void *ctx;
+    int parallelism;
+    bqueue in;                    // batches waiting for this stage
+    pthread_t workers[PIPELINE_MAX_WORKERS];
+    atomic_int running;           // workers not yet exited. The last one closes the next stage's queue
+    struct pipeline *p;
+    int index;
+    // Ordered mode: the sequence number of the next batch to hand to the next stage
+    pthread_mutex_t order_lock;
+    pthread_cond_t order_cond;
+    long next_seq;
+    // Stats
+    atomic_long items_in;
+    atomic_long items_out;
+    atomic_long busy_ns;          // time spent in fn, over all workers
+    atomic_long depth_sum;        // depth of the input queue, sampled at every batch pushed into it
+    atomic_long depth_samples;
+    atomic_int max_depth;
+} pipeline_stage;
+
+typedef struct pipeline {
+    pipeline_stage stages[PIPELINE_MAX_STAGES];
+    int num_stages;
+    bool ordered;
+    int queue_capacity;           // batches per queue
+    pipeline_batch *current;      // batch being filled by pipeline_push()
+    long next_seq;
+    double start_time;
+    double end_time;
+} pipeline;
+
+
+
+// Wall-clock time in seconds
+double pipeline_now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Initialize an empty pipeline. Queues between stages hold up to queue_capacity batches
+void pipeline_init(pipeline *p, bool ordered, int queue_capacity) {
+    p->num_stages = 0;
+    p->ordered = ordered;
+    p->queue_capacity = queue_capacity;
+    p->current = NULL;
+    p->next_seq = 0;
+    p->start_time = 0;
+    p->end_time = 0;
+}
+
+
+// Add a stage at the end of the pipeline, run by parallelism worker threads. Returns its index, or -1 on error
+int pipeline_add_stage(pipeline *p, const char *name, stage_fn fn, void *ctx, int parallelism) {
+    if (p->num_stages == PIPELINE_MAX_STAGES) {
+        printf("Pipeline is full: at most %d stages\n", PIPELINE_MAX_STAGES);
+        return -1;
+    }
+    if (parallelism < 1 || parallelism > PIPELINE_MAX_WORKERS) {
+        printf("Invalid parallelism %d for stage %s: must be 1..%d\n", parallelism, name, PIPELINE_MAX_WORKERS);
+        return -1;
+    }
+    pipeline_stage *s = &p->stages[p->num_stages];
+    s->name = name;
+    s->fn = fn;
+    s->ctx = ctx;
+    s->parallelism = parallelism;
+    s->p = p;
+    s->index = p->num_stages;
+    return p->num_stages++;
+}
+
+
+// Push a batch into the input queue of stage s, and sample the queue depth. Returns false if the queue is closed
+bool pipeline_send(pipeline_stage *s, pipeline_batch *batch) {
+    int depth = bqueue_size(&s->in);
+    atomic_fetch_add_explicit(&s->depth_sum, depth, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->depth_samples, 1, memory_order_relaxed);
+    int max_depth = atomic_load_explicit(&s->max_depth, memory_order_relaxed);
+    while (depth > max_depth && !atomic_compare_exchange_weak(&s->max_depth, &max_depth, depth)) ;
+    return bqueue_push(&s->in, batch);
+}
+
+
+// Hand a processed batch of stage s to the next stage (or free it after the last stage). In ordered mode, wait
+// until all batches before it have been handed over
+void pipeline_forward(pipeline_stage *s, pipeline_batch *batch) {
+    pipeline *p = s->p;
+    bool last = (s->index == p->num_stages - 1);
+    if (!p->ordered) {
+        if (last || batch->count == 0) free(batch);
+        else pipeline_send(&p->stages[s->index + 1], batch);
+        return;
+    }
+    pthread_mutex_lock(&s->order_lock);
+    while (s->next_seq != batch->seq) pthread_cond_wait(&s->order_cond, &s->order_lock);
+    // Pushed under order_lock, so that the next stage's queue receives the batches in sequence order. Empty batches
+    // are forwarded too: the next stage counts on getting every sequence number
+    if (last) free(batch);
+    else pipeline_send(&p->stages[s->index + 1], batch);
+    s->next_seq++;
+    pthread_cond_broadcast(&s->order_cond);
+    pthread_mutex_unlock(&s->order_lock);
+}
+
+
+// Worker thread of a stage: process batches until the input queue is closed and drained
+void* pipeline_worker(void *arg) {
+    pipeline_stage *s = (pipeline_stage*)arg;
+    pipeline *p = s->p;
+    void *item;
+    while (bqueue_pop(&s->in, &item) == BQUEUE_OK) {
+        pipeline_batch *batch = (pipeline_batch*)item;
+        double start = pipeline_now();
+        int kept = 0;
+        for (int i = 0; i < batch->count; i++) {
+            void *out;
+            if (s->fn(batch->items[i], &out, s->ctx)) batch->items[kept++] = out; // compact in place
+        }
+        atomic_fetch_add_explicit(&s->busy_ns, (long)((pipeline_now() - start) * 1e9), memory_order_relaxed);
+        atomic_fetch_add_explicit(&s->items_in, batch->count, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s->items_out, kept, memory_order_relaxed);
+        batch->count = kept;
+        pipeline_forward(s, batch);
+    }
+    // The last worker of this stage to exit closes the next stage's queue: nothing more will be pushed into it
+    if (atomic_fetch_sub(&s->running, 1) == 1 && s->index + 1 < p->num_stages) bqueue_close(&p->stages[s->index + 1].in);
+    return NULL;
+}
+
+
+// Create the queues and start the worker threads of all stages
+void pipeline_start(pipeline *p) {
+    for (int i = 0; i < p->num_stages; i++) {
+        pipeline_stage *s = &p->stages[i];
+        bqueue_init(&s->in, p->queue_capacity);
+        pthread_mutex_init(&s->order_lock, NULL);
+        pthread_cond_init(&s->order_cond, NULL);
+        s->next_seq = 0;
+        atomic_init(&s->running, s->parallelism);
+        atomic_init(&s->items_in, 0);
+        atomic_init(&s->items_out, 0);
+        atomic_init(&s->busy_ns, 0);
+        atomic_init(&s->depth_sum, 0);
+        atomic_init(&s->depth_samples, 0);
+        atomic_init(&s->max_depth, 0);
+    }
+    p->start_time = pipeline_now();
+    for (int i = 0; i < p->num_stages; i++) {
+        for (int w = 0; w < p->stages[i].parallelism; w++) {
+            pthread_create(&p->stages[i].workers[w], NULL, pipeline_worker, &p->stages[i]);
+        }
+    }
+}
+
+
+// Send the batch being filled by pipeline_push() (if any) into the first stage
+void pipeline_flush(pipeline *p) {
+    if (p->current == NULL) return;
+    pipeline_send(&p->stages[0], p->current);
+    p->current = NULL;
+}
+
+
+// Push an item into the pipeline. Waits while the first stage's queue is full (backpressure).
+// Must be called from one thread only, between pipeline_start() and pipeline_finish()
+void pipeline_push(pipeline *p, void *item) {
+    if (p->current == NULL) {
+        p->current = (pipeline_batch*)malloc(sizeof(pipeline_batch));
+        p->current->seq = p->next_seq++;
+        p->current->count = 0;
+    }
+    p->current->items[p->current->count++] = item;
+    if (p->current->count == PIPELINE_BATCH) pipeline_flush(p);
+}
+
+
+// Orderly shutdown: flush, close the first queue, and wait until every stage has processed all items and exited
+void pipeline_finish(pipeline *p) {
+    pipeline_flush(p);
+    bqueue_close(&p->stages[0].in);
+    for (int i = 0; i < p->num_stages; i++) {
+        for (int w = 0; w < p->stages[i].parallelism; w++) pthread_join(p->stages[i].workers[w], NULL);
+    }
+    p->end_time = pipeline_now();
+}
+
+
+// Print the stats of every stage. busy is the time spent in the stage function, as a share of the time its workers
+// had: the stage with the highest busy share is the bottleneck. It is wall-clock time, so with more threads than
+// cores it also counts the time a worker was preempted in the middle of the function
+void pipeline_print_stats(pipeline *p) {
+    double secs = p->end_time - p->start_time;
+    printf("%-10s %8s %10s %10s %12s %7s %10s %10s\n", "stage", "workers", "items in", "items out", "items/s", "busy", "avg queue", "max queue");
+    for (int i = 0; i < p->num_stages; i++) {
+        pipeline_stage *s = &p->stages[i];
+        long samples = atomic_load(&s->depth_samples);
+        printf("%-10s %8d %10ld %10ld %12.0f %6.1f%% %10.2f %10d\n", s->name, s->parallelism, atomic_load(&s->items_in),
+               atomic_load(&s->items_out), atomic_load(&s->items_in) / secs, 100.0 * atomic_load(&s->busy_ns) / 1e9 / (secs * s->parallelism),
+               samples > 0 ? (double)atomic_load(&s->depth_sum) / samples : 0.0, atomic_load(&s->max_depth));
+    }
+}
+
+
+// Free the queues of a finished pipeline
+void pipeline_destroy(pipeline *p) {
+    for (int i = 0; i < p->num_stages; i++) {
+        bqueue_destroy(&p->stages[i].in);
+        pthread_mutex_destroy(&p->stages[i].order_lock);
+        pthread_cond_destroy(&p->stages[i].order_cond);
+    }
+    p->num_stages = 0;
+}
+
+#endif
@@ -8,11 +8,17 @@ Queue - Array implementation
 3. _front() - return element at the front of the queue
 4. is_empty() - return true if queue is empty, else false
 5. is_full() - return true if queue is full, false otherwise
+6. Allocate the array from a pluggable allocator (queue_allocator), e.g. a tracking allocator that reports the memory used by the queue (see "allocator.h")
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "counters.h"
+#include "allocator.h"
+
+// Allocator for the queue array (NULL for malloc()/free())
+allocator *queue_allocator;
 
 // Return true if queue is empty, false otherwise
 bool is_empty(int *front, int *back) {
@@ -30,6 +36,7 @@ bool is_full(int *front, int *back, int arr_size) {
 void enqueue(int **arr, int arr_size, int *front, int *back, int data) {
     if (is_full(front, back, arr_size) == true) {
         printf("Queue is full. Cannot enqueue more.\n");
+        COUNT(queue_full_rejections);
         return;
     }
 
@@ -46,6 +53,7 @@ void enqueue(int **arr, int arr_size, int *front, int *back, int data) {
 void dequeue(int **arr, int arr_size, int *front, int *back) {
     if (is_empty(front, back) == 1) {
         printf("Queue is empty. Nothing to dequeue. \n");
+        COUNT(queue_empty_rejections);
         return;
     }
     else if (*front == *back) {
@@ -61,6 +69,7 @@ void dequeue(int **arr, int arr_size, int *front, int *back) {
 int _front(int **arr, int *front) {
     if (*front == -1) {
         printf("Queue empty. No front element. Returning -1\n");
+        COUNT(queue_empty_rejections);
         return -1;
     }
 
@@ -69,10 +78,13 @@ int _front(int **arr, int *front) {
 
 
 int main() {
-    int arr_size = 5;
-    int arr[arr_size];
+    // Allocate the array through a tracking allocator, to see how much memory the queue uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    queue_allocator = &tracker.base;
 
-    int *parr = arr;
+    int arr_size = 5;
+    int *parr = (int*)ds_alloc(queue_allocator, sizeof(int) * arr_size);
     int **pparr = &parr;
 
     int front = -1; // front index of the queue, initially -1 to indicate an empty queue
@@ -99,4 +111,7 @@ int main() {
     printf("front: %d, back: %d\n", front, back);
     printf("Check if queue is empty...\n");
     printf("Is Queue empty? (0/1): %d\n", is_empty(&front, &back));
+    tracking_report(&tracker, "Queue", is_empty(&front, &back) ? 0 : (back - front + arr_size) % arr_size + 1);
+    ds_free(queue_allocator, parr, sizeof(int) * arr_size);
+    counters_print();
 }
\ No newline at end of file
@@ -21,11 +21,16 @@ and enqueue at the "tail".
 2. Dequeue
 3. _front() - return element at the front of the queue
 4. is_empty() - return true if queue is empty, else false
+5. Bulk load data from a file or stdin: run the program with the file name as its argument ("-" for stdin) (see "bulk_load.h")
+6. Allocate the nodes from a pluggable allocator (queue_allocator), e.g. a tracking allocator that reports the memory used by the queue (see "allocator.h")
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "bulk_load.h"
+#include "counters.h"
+#include "allocator.h"
 
 // Linked List node
 typedef struct node {
@@ -33,6 +38,9 @@ typedef struct node {
     struct node *next;
 } node;
 
+// Allocator for the queue nodes (NULL for malloc()/free()). Set it before the first enqueue
+allocator *queue_allocator;
+
 
 // Check if queue is empty. Return true if yes, false otherwise
 bool is_empty(node **front) {
@@ -46,6 +54,7 @@ int _front(node **front) {
     // Check if queue is empty
     if (is_empty(front) == 1) {
         printf("Queue is empty. Returning -1\n");
+        COUNT(queue_empty_rejections);
         return -1;
     }
 
@@ -58,12 +67,13 @@ void dequeue(node **front, node **back) {
     // Check if queue is empty
     if (is_empty(front) == 1) {
         printf("Queue is empty. Nothing to dequeue\n");
+        COUNT(queue_empty_rejections);
         return;
     }
 
     node *first = *front;
     *front = first->next;
-    free(first);
+    ds_free(queue_allocator, first, sizeof(node));
 
     // When queue is empty, put back ptr to NULL
     if (*front == NULL) *back = NULL; 
@@ -73,7 +83,7 @@ void dequeue(node **front, node **back) {
 // Insert node at the back of the queue
 void enqueue(node **front, node **back, int x) {
     // Create a new node
-    node* new_node = (node*)malloc(sizeof(node));
+    node* new_node = (node*)ds_alloc(queue_allocator, sizeof(node));
     new_node->data = x; // Add data
     new_node->next = NULL; // Put address of last node's next ptr to NULL
 
@@ -90,11 +100,40 @@ void enqueue(node **front, node **back, int x) {
 }
 
 
+// Front and back ptrs of the queue that bulk-loaded batches are enqueued to
+typedef struct queue_ends {
+    node **front;
+    node **back;
+} queue_ends;
+
+
+// Enqueue a batch of bulk-loaded data to the queue passed as ctx
+void load_batch(int *batch, int count, void *ctx) {
+    queue_ends *q = (queue_ends*)ctx;
+    for (int i = 0; i < count; i++) enqueue(q->front, q->back, batch[i]);
+}
 
-int main() {
+
+
+int main(int argc, char *argv[]) {
     // In the beginning, queue is empty, so we initialize front and back ptrs to NULL
     node *front = NULL;
     node *back = NULL;
+    // Allocate the nodes through a tracking allocator, to see how much memory the queue uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    queue_allocator = &tracker.base;
+
+    if (argc > 1) {
+        // Bulk load from a file ("-" for stdin) instead of prompting for every element
+        queue_ends q = {&front, &back};
+        long loaded = bulk_load(argv[1], load_batch, &q);
+        printf("Loaded %ld elements. Element at front of queue: %d\n", loaded, _front(&front));
+        tracking_report(&tracker, "Queue", loaded);
+        while (!is_empty(&front)) dequeue(&front, &back);
+        counters_print();
+        return loaded < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
 
     int n; // Number of elements to enqueue
     int x; // Data to push
@@ -116,4 +155,6 @@ int main() {
     dequeue(&front, &back);
     printf("Check if queue is empty...\n");
     printf("Is Queue empty? (0/1): %d\n", is_empty(&front));
+    tracking_report(&tracker, "Queue", n > 2 ? n - 2 : 0);
+    counters_print();
 }
\ No newline at end of file
@@ -0,0 +1,238 @@
+/*
+Compressed bitmap (Roaring-style) set of ints
+
+A BST (binary_search_tree.c) spends a 24-byte node and one malloc on every int it holds, and a linked list even
+more. When the set is dense, e.g. row ids or the ids of users matching a filter, most of those bytes are ptrs.
+A bitmap spends one bit per possible value instead, and set operations on bitmaps are just AND/OR/ANDNOT over
+64-bit words, many words per SIMD instruction. The compressed bitmap in roaring.h splits the ints into chunks of
+2^16 values and picks the cheapest representation per chunk: a sorted array of 16-bit values (sparse chunks),
+a 2^16-bit bitmap (dense chunks) or a list of runs (chunks of long runs of consecutive values). Memory per value
+is then at most about 2 bytes, and much less for runs, instead of 24.
+
+The set itself is in the header file roaring.h, so that other source files can include it: binary_search_tree.c,
+linked_list.c and doubly_linked_list.c convert their data to and from a roaring bitmap.
+
+---IMPLEMENTED OPERATIONS---
+1. Add and remove a value (roaring_add, roaring_remove)
+2. Membership test (roaring_contains)
+3. Cardinality, from the per-container counts (roaring_cardinality)
+4. Intersection, union and difference (roaring_and, roaring_or, roaring_andnot), SIMD on bitmap containers
+5. Cardinality of an intersection without building it (roaring_and_cardinality), with popcount
+6. Convert runs of consecutive values to run containers (roaring_run_optimize)
+7. Iterate over all values in order (roaring_iterate)
+8. Memory used (roaring_memory)
+
+Below, a comparison with a plain BST: memory per value, membership tests and set operations (see main())
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+#include "roaring.h"
+
+
+
+// Plain BST node, to compare with
+typedef struct bst_node {
+    int data;
+    struct bst_node *left;
+    struct bst_node *right;
+} bst_node;
+
+
+// Insert into a plain BST (no duplicates), allocating from alloc
+void bst_insert(bst_node **root, int data, allocator *alloc) {
+    while (*root != NULL) {
+        if (data == (*root)->data) return;
+        root = (data < (*root)->data) ? &((*root)->left) : &((*root)->right);
+    }
+    *root = (bst_node*)ds_alloc(alloc, sizeof(bst_node));
+    (*root)->data = data;
+    (*root)->left = NULL;
+    (*root)->right = NULL;
+}
+
+
+// Search a plain BST
+bool bst_search(bst_node **root, int data) {
+    bst_node *temp = *root;
+    while (temp != NULL) {
+        if (data == temp->data) return true;
+        temp = (data < temp->data) ? temp->left : temp->right;
+    }
+    return false;
+}
+
+
+// Append to out, in order, every value of root that is (want = true) or is not (want = false) in other.
+// Returns the new number of values in out
+long bst_filter(bst_node *root, bst_node **other, bool want, int *out, long n) {
+    if (root == NULL) return n;
+    n = bst_filter(root->left, other, want, out, n);
+    if (bst_search(other, root->data) == want) out[n++] = root->data;
+    return bst_filter(root->right, other, want, out, n);
+}
+
+
+// Free a plain BST
+void bst_free(bst_node *root, allocator *alloc) {
+    while (root != NULL) {
+        bst_free(root->left, alloc);
+        bst_node *right = root->right;
+        ds_free(alloc, root, sizeof(bst_node));
+        root = right;
+    }
+}
+
+
+// Print a value of the set
+void print_value(int value, void *ctx) {
+    (void)ctx;
+    printf(" %d", value);
+}
+
+
+// Print the set on one line
+void print_set(roaring *r) {
+    roaring_iterate(r, print_value, NULL);
+    printf(" (%ld values)\n", roaring_cardinality(r));
+}
+
+
+// Fill a roaring bitmap and a plain BST with the same n values, in random order. Values are either random ints
+// in [0, range) or, if runs is true, runs of 1000 consecutive values starting at random points of [0, range)
+void fill_sets(roaring *r, bst_node **bst, allocator *bst_alloc, int n, int range, bool runs, unsigned int *state) {
+    int *values = (int*)malloc(sizeof(int) * n);
+    int run_start = 0;
+    for (int i = 0; i < n; i++) {
+        *state ^= *state << 13; *state ^= *state >> 17; *state ^= *state << 5; // xorshift32
+        if (runs && i % 1000 == 0) run_start = (int)(*state % (unsigned int)(range / 1000)) * 1000;
+        values[i] = runs ? run_start + i % 1000 : (int)(*state % (unsigned int)range);
+    }
+    // Shuffle, so that runs do not turn the BST into linked lists
+    for (int i = n - 1; i > 0; i--) {
+        *state ^= *state << 13; *state ^= *state >> 17; *state ^= *state << 5;
+        int j = *state % (unsigned int)(i + 1);
+        int temp = values[i]; values[i] = values[j]; values[j] = temp;
+    }
+    for (int i = 0; i < n; i++) {
+        roaring_add(r, values[i]);
+        bst_insert(bst, values[i], bst_alloc);
+    }
+    free(values);
+}
+
+
+// Benchmark: 2 sets of n values in [0, range), as roaring bitmaps and plain BSTs.
+// Compare memory per value, n membership tests, and intersection/union/difference
+void compare_with_bst(int n, int range, bool runs) {
+    tracking_allocator roaring_tracker, bst_tracker;
+    tracking_init(&roaring_tracker, NULL);
+    tracking_init(&bst_tracker, NULL);
+    roaring a, b, result;
+    roaring_init(&a, &roaring_tracker.base);
+    roaring_init(&b, &roaring_tracker.base);
+    roaring_init(&result, &roaring_tracker.base);
+    bst_node *bst_a = NULL, *bst_b = NULL;
+    unsigned int state = 2463534242u;
+    fill_sets(&a, &bst_a, &bst_tracker.base, n, range, runs, &state);
+    fill_sets(&b, &bst_b, &bst_tracker.base, n, range, runs, &state);
+    int run_containers = runs ? roaring_run_optimize(&a) + roaring_run_optimize(&b) : 0;
+
+    printf("\n2 sets of %d %s in [0, %d): %ld and %ld distinct values, %d run containers\n", n,
+           runs ? "values in runs of 1000" : "random values", range, roaring_cardinality(&a), roaring_cardinality(&b), run_containers);
+    tracking_report(&roaring_tracker, "Roaring", roaring_cardinality(&a) + roaring_cardinality(&b));
+    tracking_report(&bst_tracker, "BST", roaring_cardinality(&a) + roaring_cardinality(&b));
+
+    clock_t start = clock();
+    long roaring_found = 0;
+    for (int i = 0; i < n; i++) roaring_found += roaring_contains(&a, (int)((i * 7919L) % range));
+    double roaring_search_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    long bst_found = 0;
+    for (int i = 0; i < n; i++) bst_found += bst_search(&bst_a, (int)((i * 7919L) % range));
+    double bst_search_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%d lookups: roaring %.4f s (%ld found), BST %.4f s (%ld found)\n", n, roaring_search_secs, roaring_found, bst_search_secs, bst_found);
+
+    const char *names[] = {"AND", "OR", "ANDNOT"};
+    int *result_values = (int*)malloc(sizeof(int) * 2 * n);
+    for (int op = ROARING_AND; op <= ROARING_ANDNOT; op++) {
+        start = clock();
+        roaring_op(&a, &b, &result, op);
+        double roaring_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        // BST: walk a in order and look up every value in b. OR also takes every value of b that is not in a.
+        // The result is collected in an array: inserting it in order into a plain BST would build a linked list
+        start = clock();
+        bst_node *none = NULL;
+        long bst_result = bst_filter(bst_a, (op == ROARING_OR) ? &none : &bst_b, op == ROARING_AND, result_values, 0);
+        if (op == ROARING_OR) bst_result = bst_filter(bst_b, &bst_a, false, result_values, bst_result);
+        double bst_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        printf("%-6s: roaring %.5f s (%ld values), BST %.4f s (%ld values)\n", names[op], roaring_secs, roaring_cardinality(&result), bst_secs, bst_result);
+    }
+    start = clock();
+    long and_cardinality = roaring_and_cardinality(&a, &b);
+    printf("AND cardinality only: roaring %.5f s (%ld)\n", (double)(clock() - start) / CLOCKS_PER_SEC, and_cardinality);
+
+    free(result_values);
+    roaring_free(&a);
+    roaring_free(&b);
+    roaring_free(&result);
+    bst_free(bst_a, &bst_tracker.base);
+    bst_free(bst_b, &bst_tracker.base);
+}
+
+
+
+int main() {
+    roaring set, other, result;
+    roaring_init(&set, NULL); // Empty sets
+    roaring_init(&other, NULL);
+    roaring_init(&result, NULL);
+    int n, x;
+
+    printf("Enter the number of values to add: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter value to add: ");
+        scanf("%d", &x);
+        roaring_add(&set, x);
+    }
+
+    int demo_values[] = {42, -7, 1000, 1001, 65536, 65537, 1 << 24, -2000000000, 2000000000, 300};
+    for (int i = 0; i < 10; i++) roaring_add(&set, demo_values[i]);
+    for (int i = 0; i < 10000; i++) roaring_add(&other, 60000 + i); // 2 dense chunks: bitmap containers
+    printf("\nSet:");
+    print_set(&set);
+    printf("Is 1001 in the set? %d. Is 1002? %d\n", roaring_contains(&set, 1001), roaring_contains(&set, 1002));
+    roaring_remove(&set, 1001);
+    printf("After removing 1001:");
+    print_set(&set);
+
+    roaring_and(&set, &other, &result);
+    printf("Set AND [60000, 70000):");
+    print_set(&result);
+    roaring_andnot(&set, &other, &result);
+    printf("Set ANDNOT [60000, 70000):");
+    print_set(&result);
+    roaring_or(&set, &other, &result);
+    printf("Set OR [60000, 70000): %ld values, %zu bytes", roaring_cardinality(&result), roaring_memory(&result));
+    roaring_run_optimize(&result);
+    printf(", %zu bytes after run_optimize\n", roaring_memory(&result));
+
+    roaring_free(&set);
+    roaring_free(&other);
+    roaring_free(&result);
+
+    compare_with_bst(1 << 20, 1 << 24, false);
+    compare_with_bst(1 << 20, 1 << 22, false);
+    compare_with_bst(1 << 20, 1 << 24, true);
+    counters_print();
+
+    return EXIT_SUCCESS;
+}
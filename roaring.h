@@ -0,0 +1,651 @@
+// This header file contains a compressed bitmap set of ints (in the style of Roaring bitmaps), defined here so that
+// other .c source files can include it. For example, roaring.c uses it to compare with a BST of ints, and
+// binary_search_tree.c, linked_list.c and doubly_linked_list.c convert their data to and from it.
+//
+// A BST spends a 24-byte node (and a malloc) on every int. For dense sets, one bit per possible value is much
+// cheaper, but a plain bitmap over all 2^32 ints would be 512 MB. So the ints are split into chunks of 2^16
+// values by their upper 16 bits, and every non-empty chunk gets a container for the lower 16 bits, of one of 3 types:
+// - array:  sorted array of uint16_t values, 2 bytes per value, for chunks with at most 4096 values
+// - bitmap: 2^16 bits (8 KB), for chunks with more than 4096 values, i.e. at most 2 bytes per value too
+// - run:    sorted (start, length - 1) pairs of uint16_t, 4 bytes per run of consecutive values, for chunks made of
+//           a few long runs. Only created by roaring_run_optimize(), when it is smaller than the other two types
+// The containers are kept in an array sorted by their upper 16 bits, so the whole set is ordered.
+//
+// Set operations (AND, OR, ANDNOT) work chunk by chunk. Two bitmap containers are combined 64 bits at a time,
+// with SIMD (AVX2 or SSE2) when available, and their cardinality is counted with popcount. Array containers are
+// merged like sorted lists. Runs are first expanded into an array or bitmap. A result bitmap with at most 4096
+// values is turned back into an array.
+//
+// Values are ints. Their sign bit is flipped to get the 32-bit unsigned value that is stored, so that the order of
+// the stored values is the order of the ints (negative values first).
+
+
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "allocator.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define ROARING_ARRAY_MAX 4096     // an array container with more values becomes a bitmap
+#define ROARING_BITMAP_WORDS 1024  // 2^16 bits in 64-bit words
+
+enum roaring_container_type {
+    ROARING_ARRAY,
+    ROARING_BITMAP,
+    ROARING_RUN
+};
+
+// Container for the values of one chunk: all values whose upper 16 bits are key
+typedef struct roaring_container {
+    uint16_t key;
+    uint8_t type;
+    int cardinality;  // number of values
+    int size;         // array: number of values, run: number of runs
+    int capacity;     // array: allocated values, run: allocated runs
+    uint16_t *values; // array: sorted values, run: (start, length - 1) pairs
+    uint64_t *bitmap; // bitmap: ROARING_BITMAP_WORDS words
+} roaring_container;
+
+typedef struct roaring {
+    roaring_container *containers; // sorted by key
+    int size;                      // number of containers
+    int capacity;
+    allocator *alloc;              // allocator for the containers and their contents (NULL for malloc()/free())
+} roaring;
+
+// Called with every value of a roaring bitmap by roaring_iterate(). ctx is passed through from roaring_iterate()
+typedef void (*roaring_fn)(int value, void *ctx);
+
+
+
+// Map an int to the stored 32-bit value and back
+uint32_t roaring_to_stored(int value) {
+    return (uint32_t)value ^ 0x80000000u;
+}
+
+int roaring_from_stored(uint32_t stored) {
+    return (int)(stored ^ 0x80000000u);
+}
+
+
+// Bytes used by the contents of a container
+size_t roaring_container_bytes(roaring_container *c) {
+    if (c->type == ROARING_BITMAP) return sizeof(uint64_t) * ROARING_BITMAP_WORDS;
+    if (c->type == ROARING_ARRAY) return sizeof(uint16_t) * c->capacity;
+    return 2 * sizeof(uint16_t) * c->capacity;
+}
+
+
+// Free the contents of a container
+void roaring_container_free(roaring *r, roaring_container *c) {
+    if (c->type == ROARING_BITMAP) ds_free(r->alloc, c->bitmap, roaring_container_bytes(c));
+    else ds_free(r->alloc, c->values, roaring_container_bytes(c));
+    c->values = NULL;
+    c->bitmap = NULL;
+}
+
+
+// Initialize an empty roaring bitmap, allocating from alloc (NULL for malloc()/free())
+void roaring_init(roaring *r, allocator *alloc) {
+    r->containers = NULL;
+    r->size = 0;
+    r->capacity = 0;
+    r->alloc = alloc;
+}
+
+
+// Free all containers. The roaring bitmap is left empty and can be reused
+void roaring_free(roaring *r) {
+    for (int i = 0; i < r->size; i++) roaring_container_free(r, &r->containers[i]);
+    ds_free(r->alloc, r->containers, sizeof(roaring_container) * r->capacity);
+    roaring_init(r, r->alloc);
+}
+
+
+// Return the number of values (cardinality)
+long roaring_cardinality(roaring *r) {
+    long cardinality = 0;
+    for (int i = 0; i < r->size; i++) cardinality += r->containers[i].cardinality;
+    return cardinality;
+}
+
+
+// Return the number of bytes used by the roaring bitmap
+size_t roaring_memory(roaring *r) {
+    size_t bytes = sizeof(roaring) + sizeof(roaring_container) * r->capacity;
+    for (int i = 0; i < r->size; i++) bytes += roaring_container_bytes(&r->containers[i]);
+    return bytes;
+}
+
+
+// Return the index of the container for key, or -(insertion point) - 1 if there is none
+int roaring_find_container(roaring *r, uint16_t key) {
+    // Values often arrive in increasing order, so check the last container first
+    if (r->size > 0 && r->containers[r->size - 1].key == key) return r->size - 1;
+    int lo = 0, hi = r->size - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (r->containers[mid].key < key) lo = mid + 1;
+        else if (r->containers[mid].key > key) hi = mid - 1;
+        else return mid;
+    }
+    return -lo - 1;
+}
+
+
+// Insert an empty array container for key at index i, and return it
+roaring_container* roaring_insert_container(roaring *r, int i, uint16_t key) {
+    if (r->size == r->capacity) {
+        int new_capacity = r->capacity > 0 ? r->capacity * 2 : 4;
+        r->containers = (roaring_container*)ds_realloc(r->alloc, r->containers,
+            sizeof(roaring_container) * r->capacity, sizeof(roaring_container) * new_capacity);
+        r->capacity = new_capacity;
+    }
+    memmove(&r->containers[i + 1], &r->containers[i], sizeof(roaring_container) * (r->size - i));
+    r->size++;
+    roaring_container *c = &r->containers[i];
+    c->key = key;
+    c->type = ROARING_ARRAY;
+    c->cardinality = 0;
+    c->size = 0;
+    c->capacity = 0;
+    c->values = NULL;
+    c->bitmap = NULL;
+    return c;
+}
+
+
+// Remove the (already freed) container at index i
+void roaring_remove_container(roaring *r, int i) {
+    memmove(&r->containers[i], &r->containers[i + 1], sizeof(roaring_container) * (r->size - i - 1));
+    r->size--;
+}
+
+
+// Number of set bits in a bitmap container's words
+int roaring_bitmap_count(uint64_t *bitmap) {
+    int count = 0;
+    for (int i = 0; i < ROARING_BITMAP_WORDS; i++) count += __builtin_popcountll(bitmap[i]);
+    return count;
+}
+
+
+// Turn an array or run container into a bitmap container
+void roaring_to_bitmap(roaring *r, roaring_container *c) {
+    uint64_t *bitmap = (uint64_t*)ds_alloc(r->alloc, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+    memset(bitmap, 0, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+    if (c->type == ROARING_ARRAY) {
+        for (int i = 0; i < c->size; i++) bitmap[c->values[i] >> 6] |= 1ull << (c->values[i] & 63);
+    }
+    else {
+        for (int i = 0; i < c->size; i++) {
+            uint32_t start = c->values[2 * i], end = start + c->values[2 * i + 1];
+            for (uint32_t v = start; v <= end; v++) bitmap[v >> 6] |= 1ull << (v & 63);
+        }
+    }
+    roaring_container_free(r, c);
+    c->type = ROARING_BITMAP;
+    c->bitmap = bitmap;
+    c->size = 0;
+    c->capacity = 0;
+}
+
+
+// Turn a bitmap or run container into an array container (it must have at most ROARING_ARRAY_MAX values)
+void roaring_to_array(roaring *r, roaring_container *c) {
+    uint16_t *values = (uint16_t*)ds_alloc(r->alloc, sizeof(uint16_t) * (c->cardinality > 0 ? c->cardinality : 1));
+    int n = 0;
+    if (c->type == ROARING_BITMAP) {
+        for (int i = 0; i < ROARING_BITMAP_WORDS; i++) {
+            for (uint64_t w = c->bitmap[i]; w != 0; w &= w - 1) values[n++] = (uint16_t)(i * 64 + __builtin_ctzll(w));
+        }
+    }
+    else {
+        for (int i = 0; i < c->size; i++) {
+            uint32_t start = c->values[2 * i], end = start + c->values[2 * i + 1];
+            for (uint32_t v = start; v <= end; v++) values[n++] = (uint16_t)v;
+        }
+    }
+    roaring_container_free(r, c);
+    c->type = ROARING_ARRAY;
+    c->values = values;
+    c->size = n;
+    c->capacity = c->cardinality > 0 ? c->cardinality : 1;
+}
+
+
+// Turn a run container into an array or bitmap container, whichever fits its cardinality
+void roaring_unrun(roaring *r, roaring_container *c) {
+    if (c->type != ROARING_RUN) return;
+    if (c->cardinality <= ROARING_ARRAY_MAX) roaring_to_array(r, c);
+    else roaring_to_bitmap(r, c);
+}
+
+
+// Binary search for v in a sorted array of n values. Returns its index, or -(insertion point) - 1
+int roaring_array_find(uint16_t *values, int n, uint16_t v) {
+    int lo = 0, hi = n - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (values[mid] < v) lo = mid + 1;
+        else if (values[mid] > v) hi = mid - 1;
+        else return mid;
+    }
+    return -lo - 1;
+}
+
+
+// Add value to the set
+void roaring_add(roaring *r, int value) {
+    uint32_t stored = roaring_to_stored(value);
+    uint16_t key = (uint16_t)(stored >> 16), low = (uint16_t)stored;
+    int i = roaring_find_container(r, key);
+    roaring_container *c = (i >= 0) ? &r->containers[i] : roaring_insert_container(r, -i - 1, key);
+    roaring_unrun(r, c);
+
+    if (c->type == ROARING_BITMAP) {
+        uint64_t bit = 1ull << (low & 63);
+        if (!(c->bitmap[low >> 6] & bit)) c->cardinality++;
+        c->bitmap[low >> 6] |= bit;
+        return;
+    }
+    // Values often arrive in increasing order, so check for an append first
+    int pos = (c->size == 0 || c->values[c->size - 1] < low) ? -c->size - 1 : roaring_array_find(c->values, c->size, low);
+    if (pos >= 0) return; // already in the set
+    if (c->size == ROARING_ARRAY_MAX) {
+        roaring_to_bitmap(r, c);
+        roaring_add(r, value);
+        return;
+    }
+    if (c->size == c->capacity) {
+        int new_capacity = c->capacity > 0 ? c->capacity * 2 : 4;
+        if (new_capacity > ROARING_ARRAY_MAX) new_capacity = ROARING_ARRAY_MAX;
+        c->values = (uint16_t*)ds_realloc(r->alloc, c->values, sizeof(uint16_t) * c->capacity, sizeof(uint16_t) * new_capacity);
+        c->capacity = new_capacity;
+    }
+    pos = -pos - 1;
+    memmove(&c->values[pos + 1], &c->values[pos], sizeof(uint16_t) * (c->size - pos));
+    c->values[pos] = low;
+    c->size++;
+    c->cardinality++;
+}
+
+
+// Remove value from the set. Returns false if it was not in the set
+bool roaring_remove(roaring *r, int value) {
+    uint32_t stored = roaring_to_stored(value);
+    uint16_t key = (uint16_t)(stored >> 16), low = (uint16_t)stored;
+    int i = roaring_find_container(r, key);
+    if (i < 0) return false;
+    roaring_container *c = &r->containers[i];
+    roaring_unrun(r, c);
+
+    if (c->type == ROARING_BITMAP) {
+        uint64_t bit = 1ull << (low & 63);
+        if (!(c->bitmap[low >> 6] & bit)) return false;
+        c->bitmap[low >> 6] &= ~bit;
+        c->cardinality--;
+        if (c->cardinality <= ROARING_ARRAY_MAX / 2) roaring_to_array(r, c); // not at ROARING_ARRAY_MAX, to avoid flip-flopping
+        return true;
+    }
+    int pos = roaring_array_find(c->values, c->size, low);
+    if (pos < 0) return false;
+    memmove(&c->values[pos], &c->values[pos + 1], sizeof(uint16_t) * (c->size - pos - 1));
+    c->size--;
+    c->cardinality--;
+    if (c->cardinality == 0) {
+        roaring_container_free(r, c);
+        roaring_remove_container(r, i);
+    }
+    return true;
+}
+
+
+// Return true if value is in the set
+bool roaring_contains(roaring *r, int value) {
+    uint32_t stored = roaring_to_stored(value);
+    uint16_t key = (uint16_t)(stored >> 16), low = (uint16_t)stored;
+    int i = roaring_find_container(r, key);
+    if (i < 0) return false;
+    roaring_container *c = &r->containers[i];
+    if (c->type == ROARING_BITMAP) return (c->bitmap[low >> 6] >> (low & 63)) & 1;
+    if (c->type == ROARING_ARRAY) return roaring_array_find(c->values, c->size, low) >= 0;
+    // Run: find the last run starting at or before low
+    int lo = 0, hi = c->size - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (c->values[2 * mid] <= low) {
+            found = mid;
+            lo = mid + 1;
+        }
+        else hi = mid - 1;
+    }
+    return found >= 0 && low - c->values[2 * found] <= c->values[2 * found + 1];
+}
+
+
+// Call fn(value, ctx) for every value, in increasing order
+void roaring_iterate(roaring *r, roaring_fn fn, void *ctx) {
+    for (int i = 0; i < r->size; i++) {
+        roaring_container *c = &r->containers[i];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (c->type == ROARING_ARRAY) {
+            for (int j = 0; j < c->size; j++) fn(roaring_from_stored(high | c->values[j]), ctx);
+        }
+        else if (c->type == ROARING_BITMAP) {
+            for (int j = 0; j < ROARING_BITMAP_WORDS; j++) {
+                for (uint64_t w = c->bitmap[j]; w != 0; w &= w - 1) fn(roaring_from_stored(high | (j * 64 + __builtin_ctzll(w))), ctx);
+            }
+        }
+        else {
+            for (int j = 0; j < c->size; j++) {
+                uint32_t start = c->values[2 * j], end = start + c->values[2 * j + 1];
+                for (uint32_t v = start; v <= end; v++) fn(roaring_from_stored(high | v), ctx);
+            }
+        }
+    }
+}
+
+
+// Append value v to the (start, length - 1) pairs of a run container being built, with n runs so far
+void roaring_append_run(uint16_t *pairs, int *n, uint16_t v) {
+    if (*n > 0 && pairs[2 * *n - 2] + pairs[2 * *n - 1] + 1 == v) pairs[2 * *n - 1]++;
+    else {
+        pairs[2 * *n] = v;
+        pairs[2 * *n + 1] = 0;
+        (*n)++;
+    }
+}
+
+
+// Number of runs of consecutive values in a bitmap container
+int roaring_bitmap_runs(uint64_t *bitmap) {
+    int runs = 0;
+    uint64_t carry = 0; // highest bit of the previous word
+    for (int i = 0; i < ROARING_BITMAP_WORDS; i++) {
+        uint64_t w = bitmap[i];
+        runs += __builtin_popcountll(w & ~((w << 1) | carry)); // a set bit whose lower neighbour is not set starts a run
+        carry = w >> 63;
+    }
+    return runs;
+}
+
+
+// Turn every container into a run container if that uses less memory. Returns the number of run containers
+int roaring_run_optimize(roaring *r) {
+    int run_containers = 0;
+    for (int i = 0; i < r->size; i++) {
+        roaring_container *c = &r->containers[i];
+        if (c->type == ROARING_RUN) {
+            run_containers++;
+            continue;
+        }
+        int runs = 0;
+        size_t current_bytes;
+        if (c->type == ROARING_BITMAP) {
+            runs = roaring_bitmap_runs(c->bitmap);
+            current_bytes = sizeof(uint64_t) * ROARING_BITMAP_WORDS;
+        }
+        else {
+            for (int j = 0; j < c->size; j++) runs += (j == 0 || c->values[j] != c->values[j - 1] + 1);
+            current_bytes = sizeof(uint16_t) * c->size;
+        }
+        if (2 * sizeof(uint16_t) * runs >= current_bytes) continue;
+
+        uint16_t *pairs = (uint16_t*)ds_alloc(r->alloc, 2 * sizeof(uint16_t) * runs);
+        int n = 0;
+        if (c->type == ROARING_BITMAP) {
+            for (int j = 0; j < ROARING_BITMAP_WORDS; j++) {
+                for (uint64_t w = c->bitmap[j]; w != 0; w &= w - 1) roaring_append_run(pairs, &n, (uint16_t)(j * 64 + __builtin_ctzll(w)));
+            }
+        }
+        else {
+            for (int j = 0; j < c->size; j++) roaring_append_run(pairs, &n, c->values[j]);
+        }
+        roaring_container_free(r, c);
+        c->type = ROARING_RUN;
+        c->values = pairs;
+        c->size = runs;
+        c->capacity = runs;
+        run_containers++;
+    }
+    return run_containers;
+}
+
+
+enum roaring_op {
+    ROARING_AND,
+    ROARING_OR,
+    ROARING_ANDNOT
+};
+
+
+// Combine 2 bitmaps word by word into out. Returns the cardinality of the result
+int roaring_bitmap_op(uint64_t *a, uint64_t *b, uint64_t *out, int op) {
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i < ROARING_BITMAP_WORDS; i += 4) {
+        __m256i va = _mm256_loadu_si256((__m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((__m256i*)(b + i));
+        __m256i v;
+        if (op == ROARING_AND) v = _mm256_and_si256(va, vb);
+        else if (op == ROARING_OR) v = _mm256_or_si256(va, vb);
+        else v = _mm256_andnot_si256(vb, va); // andnot computes ~first & second
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+    }
+#elif defined(__SSE2__)
+    for (; i < ROARING_BITMAP_WORDS; i += 2) {
+        __m128i va = _mm_loadu_si128((__m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((__m128i*)(b + i));
+        __m128i v;
+        if (op == ROARING_AND) v = _mm_and_si128(va, vb);
+        else if (op == ROARING_OR) v = _mm_or_si128(va, vb);
+        else v = _mm_andnot_si128(vb, va);
+        _mm_storeu_si128((__m128i*)(out + i), v);
+    }
+#endif
+    for (; i < ROARING_BITMAP_WORDS; i++) {
+        if (op == ROARING_AND) out[i] = a[i] & b[i];
+        else if (op == ROARING_OR) out[i] = a[i] | b[i];
+        else out[i] = a[i] & ~b[i];
+    }
+    return roaring_bitmap_count(out);
+}
+
+
+// Copy container c into copy, allocating from r. If expand is true, a run container is copied as an array or bitmap
+void roaring_container_copy(roaring *r, roaring_container *c, roaring_container *copy, bool expand) {
+    *copy = *c;
+    if (c->type == ROARING_BITMAP) {
+        copy->bitmap = (uint64_t*)ds_alloc(r->alloc, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+        memcpy(copy->bitmap, c->bitmap, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+        return;
+    }
+    size_t bytes = (c->type == ROARING_ARRAY ? 1 : 2) * sizeof(uint16_t) * c->size;
+    copy->capacity = c->size;
+    copy->values = (uint16_t*)ds_alloc(r->alloc, bytes);
+    memcpy(copy->values, c->values, bytes);
+    if (expand) roaring_unrun(r, copy);
+}
+
+
+// Compute out = a op b for 2 containers with the same key, neither of them a run container.
+// The contents of out are allocated from result. Returns false (and allocates nothing) if out is empty
+bool roaring_container_op(roaring *result, roaring_container *a, roaring_container *b, int op, roaring_container *out) {
+    if (op == ROARING_AND && a->type == ROARING_BITMAP && b->type == ROARING_ARRAY) {
+        roaring_container *swap = a; // AND is symmetric: keep the array on the left
+        a = b;
+        b = swap;
+    }
+    out->key = a->key;
+    out->size = 0;
+    out->capacity = 0;
+    out->values = NULL;
+    out->bitmap = NULL;
+
+    if (a->type == ROARING_ARRAY && (b->type == ROARING_ARRAY || op != ROARING_OR)) {
+        int max_values = (op == ROARING_OR) ? a->size + b->size : a->size;
+        if (max_values == 0) return false;
+        uint16_t *values = (uint16_t*)ds_alloc(result->alloc, sizeof(uint16_t) * max_values);
+        int n = 0;
+        if (b->type == ROARING_ARRAY) {
+            // Merge 2 sorted arrays
+            int i = 0, j = 0;
+            while (i < a->size && j < b->size) {
+                if (a->values[i] < b->values[j]) {
+                    if (op != ROARING_AND) values[n++] = a->values[i];
+                    i++;
+                }
+                else if (a->values[i] > b->values[j]) {
+                    if (op == ROARING_OR) values[n++] = b->values[j];
+                    j++;
+                }
+                else {
+                    if (op != ROARING_ANDNOT) values[n++] = a->values[i];
+                    i++;
+                    j++;
+                }
+            }
+            if (op != ROARING_AND) while (i < a->size) values[n++] = a->values[i++];
+            if (op == ROARING_OR) while (j < b->size) values[n++] = b->values[j++];
+        }
+        else {
+            // a is an array, b a bitmap: keep the values of a that are (AND) or are not (ANDNOT) in b
+            for (int i = 0; i < a->size; i++) {
+                bool in_b = (b->bitmap[a->values[i] >> 6] >> (a->values[i] & 63)) & 1;
+                if (in_b == (op == ROARING_AND)) values[n++] = a->values[i];
+            }
+        }
+        if (n == 0) {
+            ds_free(result->alloc, values, sizeof(uint16_t) * max_values);
+            return false;
+        }
+        out->type = ROARING_ARRAY;
+        out->values = values;
+        out->size = n;
+        out->capacity = max_values;
+        out->cardinality = n;
+        if (n > ROARING_ARRAY_MAX) roaring_to_bitmap(result, out);
+        return true;
+    }
+
+    // At least one bitmap: combine as bitmaps, with the array side (if any) expanded into a temporary bitmap
+    uint64_t *temp = NULL;
+    uint64_t *a_bits = a->bitmap, *b_bits = b->bitmap;
+    if (a->type == ROARING_ARRAY || b->type == ROARING_ARRAY) {
+        roaring_container *array = (a->type == ROARING_ARRAY) ? a : b;
+        temp = (uint64_t*)ds_alloc(result->alloc, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+        memset(temp, 0, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+        for (int i = 0; i < array->size; i++) temp[array->values[i] >> 6] |= 1ull << (array->values[i] & 63);
+        if (array == a) a_bits = temp;
+        else b_bits = temp;
+    }
+    out->type = ROARING_BITMAP;
+    out->bitmap = (uint64_t*)ds_alloc(result->alloc, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+    out->cardinality = roaring_bitmap_op(a_bits, b_bits, out->bitmap, op);
+    if (temp != NULL) ds_free(result->alloc, temp, sizeof(uint64_t) * ROARING_BITMAP_WORDS);
+    if (out->cardinality == 0) {
+        roaring_container_free(result, out);
+        return false;
+    }
+    if (out->cardinality <= ROARING_ARRAY_MAX) roaring_to_array(result, out);
+    return true;
+}
+
+
+// Compute result = a op b. result must be initialized and must not be a or b; its previous values are freed.
+// a and b are left unchanged (run containers are expanded into temporary copies)
+void roaring_op(roaring *a, roaring *b, roaring *result, int op) {
+    roaring_free(result);
+    int i = 0, j = 0;
+    while (i < a->size || j < b->size) {
+        roaring_container *ca = (i < a->size) ? &a->containers[i] : NULL;
+        roaring_container *cb = (j < b->size) ? &b->containers[j] : NULL;
+        roaring_container out;
+        if (cb == NULL || (ca != NULL && ca->key < cb->key)) {
+            // Chunk only in a: copied by OR and ANDNOT
+            if (op != ROARING_AND) {
+                roaring_container_copy(result, ca, &out, false);
+                *roaring_insert_container(result, result->size, out.key) = out;
+            }
+            i++;
+        }
+        else if (ca == NULL || cb->key < ca->key) {
+            // Chunk only in b: copied by OR
+            if (op == ROARING_OR) {
+                roaring_container_copy(result, cb, &out, false);
+                *roaring_insert_container(result, result->size, out.key) = out;
+            }
+            j++;
+        }
+        else {
+            roaring_container ea, eb;
+            if (ca->type == ROARING_RUN) roaring_container_copy(result, ca, &ea, true);
+            if (cb->type == ROARING_RUN) roaring_container_copy(result, cb, &eb, true);
+            bool non_empty = roaring_container_op(result, ca->type == ROARING_RUN ? &ea : ca, cb->type == ROARING_RUN ? &eb : cb, op, &out);
+            if (ca->type == ROARING_RUN) roaring_container_free(result, &ea);
+            if (cb->type == ROARING_RUN) roaring_container_free(result, &eb);
+            if (non_empty) *roaring_insert_container(result, result->size, out.key) = out;
+            i++;
+            j++;
+        }
+    }
+}
+
+
+// result = a AND b (intersection)
+void roaring_and(roaring *a, roaring *b, roaring *result) {
+    roaring_op(a, b, result, ROARING_AND);
+}
+
+// result = a OR b (union)
+void roaring_or(roaring *a, roaring *b, roaring *result) {
+    roaring_op(a, b, result, ROARING_OR);
+}
+
+// result = a AND NOT b (difference)
+void roaring_andnot(roaring *a, roaring *b, roaring *result) {
+    roaring_op(a, b, result, ROARING_ANDNOT);
+}
+
+
+// Cardinality of a AND b, without building the result. Bitmap pairs are counted with popcount only
+long roaring_and_cardinality(roaring *a, roaring *b) {
+    long cardinality = 0;
+    int i = 0, j = 0;
+    while (i < a->size && j < b->size) {
+        roaring_container *ca = &a->containers[i], *cb = &b->containers[j];
+        if (ca->key < cb->key) i++;
+        else if (cb->key < ca->key) j++;
+        else {
+            if (ca->type == ROARING_BITMAP && cb->type == ROARING_BITMAP) {
+                for (int w = 0; w < ROARING_BITMAP_WORDS; w++) cardinality += __builtin_popcountll(ca->bitmap[w] & cb->bitmap[w]);
+            }
+            else {
+                roaring temp;
+                roaring_init(&temp, a->alloc);
+                roaring_container ea, eb, out;
+                roaring_container_copy(&temp, ca, &ea, true);
+                roaring_container_copy(&temp, cb, &eb, true);
+                if (roaring_container_op(&temp, &ea, &eb, ROARING_AND, &out)) {
+                    cardinality += out.cardinality;
+                    roaring_container_free(&temp, &out);
+                }
+                roaring_container_free(&temp, &ea);
+                roaring_container_free(&temp, &eb);
+            }
+            i++;
+            j++;
+        }
+    }
+    return cardinality;
+}
+
+#endif
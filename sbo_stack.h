@@ -0,0 +1,138 @@
+// This header file contains a stack with small-buffer optimization (SBO), defined here so that other .c source files
+// can include it. binary_search_tree.c uses it as scratch space for iterative traversals.
+//
+// Traversals and other iterative algorithms need a scratch stack whose depth is usually tiny (the height of a
+// balanced tree) but occasionally huge (a BST built from sorted input is a linked list). stack.c starts from an
+// array of a fixed size, and stack_LL.c calls malloc() on every push. This stack keeps its first SBO_STACK_N elements
+// inline, inside the sbo_stack struct itself, which usually sits in the caller's stack frame. Only when a push finds
+// those full does it move the elements to a heap array, doubling it from then on. So the common case makes no
+// allocation at all, and there is still no depth limit.
+//
+// The element type and the inline capacity are set at compile time, by defining these before including the header:
+// - SBO_STACK_ELEM: element type (default void*)
+// - SBO_STACK_N:    number of inline elements (default 64)
+// A source file gets one element type; it can use a void* stack for anything else.
+//
+// While the elements are inline, data points into the struct itself, so an sbo_stack must not be copied or moved
+// by value (pass ptrs to it instead). For the same reason, use the functions below rather than the struct fields:
+// sbo_stack_size() and sbo_stack_at() read the elements from the bottom up, e.g. to scan a level of a tree in order.
+
+
+#ifndef SBO_STACK_H
+#define SBO_STACK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "counters.h"
+#include "allocator.h"
+
+#ifndef SBO_STACK_ELEM
+#define SBO_STACK_ELEM void*
+#endif
+#ifndef SBO_STACK_N
+#define SBO_STACK_N 64
+#endif
+
+typedef struct sbo_stack {
+    SBO_STACK_ELEM *data; // inline_buf, or a heap array once the stack has outgrown it
+    int size;             // number of elements. The top is data[size - 1]
+    int capacity;
+    SBO_STACK_ELEM inline_buf[SBO_STACK_N];
+} sbo_stack;
+
+
+
+// Initialize an empty stack, using the inline buffer
+void sbo_stack_init(sbo_stack *s) {
+    s->data = s->inline_buf;
+    s->size = 0;
+    s->capacity = SBO_STACK_N;
+}
+
+
+// Return true if the elements have moved to a heap array
+bool sbo_stack_on_heap(sbo_stack *s) {
+    return s->data != s->inline_buf;
+}
+
+
+// Free the heap array (if any). The stack is left empty and can be reused
+void sbo_stack_free(sbo_stack *s) {
+    if (sbo_stack_on_heap(s)) ds_free(NULL, s->data, sizeof(SBO_STACK_ELEM) * s->capacity);
+    sbo_stack_init(s);
+}
+
+
+// Remove all elements, keeping the heap array (if any) for the next pushes
+void sbo_stack_clear(sbo_stack *s) {
+    s->size = 0;
+}
+
+
+// Return true if stack is empty, else false
+bool sbo_stack_is_empty(sbo_stack *s) {
+    return s->size == 0;
+}
+
+
+// Return the number of elements
+int sbo_stack_size(sbo_stack *s) {
+    return s->size;
+}
+
+
+// Return the element at index i, counting from the bottom (0) to the top (size - 1), without popping anything
+SBO_STACK_ELEM sbo_stack_at(sbo_stack *s, int i) {
+    if (i < 0 || i >= s->size) {
+        printf("Stack has %d elements, no element at index %d.\n", s->size, i);
+        SBO_STACK_ELEM zero;
+        memset(&zero, 0, sizeof(zero));
+        return zero;
+    }
+    return s->data[i];
+}
+
+
+// Push x on top of the stack. Moves the elements to a heap array when the inline buffer is full, and doubles it after that
+void sbo_stack_push(sbo_stack *s, SBO_STACK_ELEM x) {
+    if (s->size == s->capacity) {
+        if (sbo_stack_on_heap(s)) {
+            s->data = (SBO_STACK_ELEM*)ds_realloc(NULL, s->data, sizeof(SBO_STACK_ELEM) * s->capacity, sizeof(SBO_STACK_ELEM) * s->capacity * 2);
+        }
+        else {
+            s->data = (SBO_STACK_ELEM*)ds_alloc(NULL, sizeof(SBO_STACK_ELEM) * s->capacity * 2);
+            memcpy(s->data, s->inline_buf, sizeof(SBO_STACK_ELEM) * s->size);
+        }
+        s->capacity *= 2;
+        COUNT(stack_resizes);
+    }
+    s->data[s->size++] = x;
+}
+
+
+// Pop the element on top of the stack and return it. The stack must not be empty
+SBO_STACK_ELEM sbo_stack_pop(sbo_stack *s) {
+    if (s->size == 0) {
+        printf("Empty stack. Nothing to pop.\n");
+        SBO_STACK_ELEM zero;
+        memset(&zero, 0, sizeof(zero));
+        return zero;
+    }
+    return s->data[--s->size];
+}
+
+
+// Return the element on top of the stack, without popping it. The stack must not be empty
+SBO_STACK_ELEM sbo_stack_top(sbo_stack *s) {
+    if (s->size == 0) {
+        printf("Empty stack. No top element.\n");
+        SBO_STACK_ELEM zero;
+        memset(&zero, 0, sizeof(zero));
+        return zero;
+    }
+    return s->data[s->size - 1];
+}
+
+#endif
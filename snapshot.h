@@ -0,0 +1,187 @@
+// This header file contains a compact binary snapshot format for the trees and lists, defined here so that
+// binary_search_tree.c, linked_list.c and doubly_linked_list.c can all include it.
+//
+// Rebuilding a container from its keys means one insert (and one malloc) per key. A snapshot file instead
+// stores the container in a frozen layout that can be mapped into memory with mmap() and queried in place:
+// no parsing, no per-node allocations, and the pages are loaded lazily by the OS and shared through the page
+// cache by every process that maps the same file.
+//
+// File layout (byte order of the machine that wrote it, all fields 4-byte aligned):
+//     snapshot_header (32 bytes)
+//     payload: count elements
+//         - SNAPSHOT_LIST: int32_t data, in list order
+//         - SNAPSHOT_BST:  snapshot_tnode {data, left, right}, where left/right are indices into the payload
+//                          (SNAPSHOT_NIL for no child), and header.root is the index of the root node
+//
+// The header carries a checksum of itself, checked on every open (O(1)), and a checksum of the payload, only
+// checked when asked for, because it has to read the whole file and so gives up the lazy loading.
+//
+// The fields are stored in the byte order of the machine that wrote the file, so that they can be used in place.
+// The header records that byte order, and a file written on a machine with the other byte order is rejected:
+// converting it would mean rewriting every element, which is what mapping the file is meant to avoid.
+
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_MAGIC 0x50414e53u // "SNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER 0x01020304u // stored as a uint32_t: its bytes in the file show the byte order of the writer
+#define SNAPSHOT_NIL UINT32_MAX
+
+enum snapshot_kind {
+    SNAPSHOT_LIST = 1,
+    SNAPSHOT_BST = 2
+};
+
+typedef struct snapshot_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t kind;
+    uint32_t count;            // number of elements in the payload
+    uint32_t root;             // BST: index of the root node, SNAPSHOT_NIL for an empty tree. Unused for lists
+    uint32_t elem_size;        // size of one payload element in bytes
+    uint32_t payload_checksum;
+    uint32_t byte_order;       // SNAPSHOT_BYTE_ORDER, as written by the machine that wrote the file
+    uint32_t header_checksum;  // checksum of all the fields above
+} snapshot_header;
+
+// Frozen BST node
+typedef struct snapshot_tnode {
+    int32_t data;
+    uint32_t left;
+    uint32_t right;
+} snapshot_tnode;
+
+// An open (mapped) snapshot file
+typedef struct snapshot {
+    void *map;
+    size_t length;
+    const snapshot_header *header;
+    const void *payload;
+} snapshot;
+
+
+// Size in bytes of one payload element of the given kind
+uint32_t snapshot_elem_size(uint16_t kind) {
+    return (kind == SNAPSHOT_BST) ? sizeof(snapshot_tnode) : sizeof(int32_t);
+}
+
+
+// 32-bit FNV-1a checksum of n bytes
+uint32_t snapshot_checksum(const void *bytes, size_t n) {
+    const unsigned char *p = (const unsigned char*)bytes;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+
+// Write count elements of elem_size bytes each into a new snapshot file. Returns false on I/O errors
+bool snapshot_write(const char *path, uint16_t kind, uint32_t root, const void *payload, uint32_t count, uint32_t elem_size) {
+    snapshot_header header = {0};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.kind = kind;
+    header.count = count;
+    header.root = root;
+    header.elem_size = elem_size;
+    header.payload_checksum = snapshot_checksum(payload, (size_t)count * elem_size);
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.header_checksum = snapshot_checksum(&header, offsetof(snapshot_header, header_checksum));
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        printf("Cannot open %s for writing.\n", path);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && (count == 0 || fwrite(payload, elem_size, count, f) == count);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) printf("Error while writing snapshot %s.\n", path);
+    return ok;
+}
+
+
+// Map a snapshot file of the given kind read-only and validate its header (and its payload if verify_payload).
+// Returns false, with an error message, if the file cannot be used
+bool snapshot_open(snapshot *s, const char *path, uint16_t kind, bool verify_payload) {
+    s->map = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open snapshot %s.\n", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snapshot_header)) {
+        printf("Snapshot %s is too small.\n", path);
+        close(fd);
+        return false;
+    }
+    s->length = (size_t)st.st_size;
+    s->map = mmap(NULL, s->length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays valid after the file descriptor is closed
+    if (s->map == MAP_FAILED) {
+        printf("Cannot mmap snapshot %s.\n", path);
+        s->map = NULL;
+        return false;
+    }
+
+    const snapshot_header *h = (const snapshot_header*)s->map;
+    const char *error = NULL;
+    if (h->magic == __builtin_bswap32(SNAPSHOT_MAGIC)) error = "written on a machine with a different byte order";
+    else if (h->magic != SNAPSHOT_MAGIC) error = "not a snapshot file";
+    else if (h->header_checksum != snapshot_checksum(h, offsetof(snapshot_header, header_checksum))) error = "corrupt header";
+    else if (h->version != SNAPSHOT_VERSION) error = "unsupported version";
+    else if (h->byte_order != SNAPSHOT_BYTE_ORDER) error = "written on a machine with a different byte order";
+    else if (h->kind != kind) error = "wrong kind of container";
+    else if (h->elem_size != snapshot_elem_size(kind)) error = "bad element size";
+    else if (s->length != sizeof(snapshot_header) + (size_t)h->count * h->elem_size) error = "truncated file";
+    else if (verify_payload && h->payload_checksum != snapshot_checksum(h + 1, (size_t)h->count * h->elem_size)) error = "corrupt payload";
+    if (error != NULL) {
+        printf("Snapshot %s: %s.\n", path, error);
+        munmap(s->map, s->length);
+        s->map = NULL;
+        return false;
+    }
+
+    s->header = h;
+    s->payload = h + 1;
+    return true;
+}
+
+
+// Unmap a snapshot
+void snapshot_close(snapshot *s) {
+    if (s->map != NULL) munmap(s->map, s->length);
+    s->map = NULL;
+}
+
+
+// Search a mapped BST snapshot in place. Returns true if data is found. A path in a valid tree visits each node at most
+// once, so the search gives up after count steps: a corrupt payload with a cycle (not caught when the checksum is not
+// verified) cannot make it loop forever
+bool snapshot_bst_search(snapshot *s, int data) {
+    const snapshot_tnode *nodes = (const snapshot_tnode*)s->payload;
+    uint32_t i = s->header->root;
+    for (uint32_t steps = 0; steps < s->header->count && i != SNAPSHOT_NIL && i < s->header->count; steps++) {
+        if (data == nodes[i].data) return true;
+        i = (data < nodes[i].data) ? nodes[i].left : nodes[i].right;
+    }
+    return false;
+}
+
+#endif
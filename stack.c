@@ -7,14 +7,25 @@ Stack - Array implementation
 2. pop
 3. top() - returns the element at the top of the stack
 4. is_empty() - returns true if stack is empty, else false
+5. push a batch of elements, growing the array at most once
+6. Bulk load data from a file or stdin: run the program with the file name as its argument ("-" for stdin) (see "bulk_load.h")
+7. Allocate the array from a pluggable allocator (stack_allocator), e.g. a tracking allocator that reports the memory used by the stack (see "allocator.h")
+
+The array has to be allocated with ds_alloc() from stack_allocator, because push() grows it with ds_realloc() when it is full.
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include "bulk_load.h"
+#include "counters.h"
+#include "allocator.h"
 #define MAX_ARRAY_SIZE 100
 
+// Allocator for the stack array (NULL for malloc()/realloc()/free())
+allocator *stack_allocator;
+
 // Push element on top of stack
 void push(int **arr, int *top, int data, int *arr_size) {
     // Some temporary notes below:
@@ -33,9 +44,11 @@ void push(int **arr, int *top, int data, int *arr_size) {
 
     if (*top == *(arr_size) - 1) {
         printf("Stack overflow. Increasing size of array.\n");
-        int new_arr[(*arr_size)*2]; // Define a new array double the size of the old one
-        memcpy(new_arr, *arr, sizeof(int)*(*arr_size)); // Copy bytes from smaller to bigger array
-        *arr = new_arr; // Change pointer to point to the new, bigger array
+        // A new local array (e.g. int new_arr[(*arr_size)*2]) would be freed as soon as push() returns, leaving *arr
+        // dangling. Instead, grow the heap array to double its size. ds_realloc() copies the old elements for us
+        *arr = (int*)ds_realloc(stack_allocator, *arr, sizeof(int) * (*arr_size), sizeof(int) * (*arr_size) * 2);
+        COUNT(stack_resizes);
+        *arr_size *= 2;
         (*top)++;
         (*arr)[*top] = data;
         return;
@@ -46,6 +59,19 @@ void push(int **arr, int *top, int data, int *arr_size) {
 }
 
 
+// Push count elements on top of stack, in order (batch[count-1] ends up on top). Grows the array at most once
+void push_batch(int **arr, int *top, int *batch, int count, int *arr_size) {
+    if (*top + count >= *arr_size) {
+        int old_size = *arr_size;
+        while (*top + count >= *arr_size) *arr_size *= 2;
+        *arr = (int*)ds_realloc(stack_allocator, *arr, sizeof(int) * old_size, sizeof(int) * (*arr_size));
+        COUNT(stack_resizes);
+    }
+    memcpy(*arr + *top + 1, batch, sizeof(int) * count);
+    *top += count;
+}
+
+
 // Pop first element off the stack
 void pop(int *top) {
     if (*top == -1) {
@@ -74,15 +100,45 @@ int _top(int **arr, int *top) {
 }
 
 
+// Stack (array, top index and array size) that bulk-loaded batches are pushed to
+typedef struct stack_state {
+    int **pparr;
+    int *top;
+    int *arr_size;
+} stack_state;
 
-int main() {
-    int arr_size = 2;
-    int arr[arr_size];
 
-    int *parr = arr;
+// Push a batch of bulk-loaded data onto the stack passed as ctx
+void load_batch(int *batch, int count, void *ctx) {
+    stack_state *s = (stack_state*)ctx;
+    push_batch(s->pparr, s->top, batch, count, s->arr_size);
+}
+
+
+
+int main(int argc, char *argv[]) {
+    // Allocate the array through a tracking allocator, to see how much memory the stack uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    stack_allocator = &tracker.base;
+
+    int arr_size = 2;
+    int *parr = (int*)ds_alloc(stack_allocator, sizeof(int) * arr_size);
     int **pparr = &parr;
 
     int top = -1;
+
+    if (argc > 1) {
+        // Bulk load from a file ("-" for stdin) instead of prompting for every element
+        stack_state s = {pparr, &top, &arr_size};
+        long loaded = bulk_load(argv[1], load_batch, &s);
+        printf("Loaded %ld elements. Stack has %d elements, top element: %d\n", loaded, top + 1, _top(pparr, &top));
+        tracking_report(&tracker, "Stack", top + 1);
+        ds_free(stack_allocator, parr, sizeof(int) * arr_size);
+        counters_print();
+        return loaded < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     int n; // Number of elements to push
     int x; // Data to push
     printf("Enter the number of elements you want to push to the stack: ");
@@ -98,6 +154,9 @@ int main() {
     pop(&top);
     printf("Top element is (if not -1): %d\n", _top(pparr, &top));
     printf("Is the stack empty: %d\n", is_empty(&top));
+    tracking_report(&tracker, "Stack", top + 1);
+    ds_free(stack_allocator, parr, sizeof(int) * arr_size);
+    counters_print();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -11,11 +11,16 @@ and deletion was already implemented in the original C code for linked lists
 2. pop
 3. top() - returns the element at the top of the stack
 4. is_empty() - returns true if stack is empty, else false
+5. Bulk load data from a file or stdin: run the program with the file name as its argument ("-" for stdin) (see "bulk_load.h")
+6. Allocate the nodes from a pluggable allocator (stack_allocator), e.g. a tracking allocator that reports the memory used by the stack (see "allocator.h")
 */
 
 #include <stdio.h>
 #include<stdlib.h>
 #include<stdbool.h>
+#include "bulk_load.h"
+#include "counters.h"
+#include "allocator.h"
 
 
 typedef struct node {
@@ -23,10 +28,13 @@ typedef struct node {
     struct node *next;
 } node;
 
+// Allocator for the stack nodes (NULL for malloc()/free()). Set it before the first push
+allocator *stack_allocator;
+
 
 // Push element on top of stack
 void push(node **top, int x) {
-    node* new_node = (node*)malloc(sizeof(node)); //allocate memory for new node
+    node* new_node = (node*)ds_alloc(stack_allocator, sizeof(node)); //allocate memory for new node
     new_node->data = x; //assign data
     new_node->next = *top; //assign the next pointer of the new node to top, which is currently pointing to the 1st node
     *top = new_node; //reassign top to the address of the new node. top now points to the new node
@@ -42,7 +50,7 @@ void pop(node **top) {
 
     node *first = *top;
     *top = first->next;
-    free(first);
+    ds_free(stack_allocator, first, sizeof(node));
 }
 
 
@@ -63,10 +71,30 @@ int _top(node **top) {
     return (*top)->data;
 }
 
-int main() {
+// Push a batch of bulk-loaded data onto the stack whose top ptr is passed as ctx
+void load_batch(int *batch, int count, void *ctx) {
+    for (int i = 0; i < count; i++) push((node**)ctx, batch[i]);
+}
+
+
+int main(int argc, char *argv[]) {
     // Initialize top node ptr to NULL. This means that, initially, the stack is empty and top doesn't point to a valid node.
     node *top = NULL;
     int num_elements, x;
+    // Allocate the nodes through a tracking allocator, to see how much memory the stack uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    stack_allocator = &tracker.base;
+
+    if (argc > 1) {
+        // Bulk load from a file ("-" for stdin) instead of prompting for every element
+        long loaded = bulk_load(argv[1], load_batch, &top);
+        printf("Loaded %ld elements. The element at the top of the stack is: %d\n", loaded, _top(&top));
+        tracking_report(&tracker, "Stack", loaded);
+        while (!is_empty(&top)) pop(&top);
+        counters_print();
+        return loaded < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
 
     printf("Enter the number of elements to add to stack: ");
     scanf("%d", &num_elements);
@@ -83,6 +111,8 @@ int main() {
 
     printf("\nThe element at the top of the stack is: %d\n", _top(&top));
     printf("Is the stack empty? Answer: %d\n", is_empty(&top));
+    tracking_report(&tracker, "Stack", num_elements > 2 ? num_elements - 2 : 0);
+    counters_print();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
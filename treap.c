@@ -0,0 +1,521 @@
+/*
+Treap (randomized balanced BST) with split and join
+
+A treap is a BST in which every node also gets a random priority, and the tree is kept as a heap on the
+priorities: every node has a higher priority than its children. For random priorities, the shape of the tree
+is the same as that of a BST built by inserting the keys in random order, so its expected height is O(log n),
+whatever the order in which the keys really arrive (e.g. sorted, which makes binary_search_tree.c a linked list).
+
+Instead of rotations, everything is built on two O(log n) operations:
+- split(key): cut the tree into a tree of the keys < key and a tree of the keys >= key. Only the nodes on the
+  search path for key are relinked
+- join(left, right): glue two trees together, when every key of left is <= every key of right. Walks down the
+  right spine of left and the left spine of right, and interleaves them by priority
+
+Removing a whole key range [lo, hi] (e.g. expiring everything below a timestamp) is then two splits and one join,
+O(log n), instead of one delete per key. The removed range comes out as a treap of its own: it can be inserted
+elsewhere, or freed. Freeing it node by node costs O(size of the range), but when the nodes come from an arena
+(treap_allocator pointing to an arena_allocator, see "allocator.h"), there is nothing to give back per node and the
+range is dropped without visiting it; the memory is reclaimed all at once when the arena is reset.
+
+Duplicates are allowed, and kept as separate nodes.
+
+Set operations (union, intersection, difference) on two treaps used as sets (no duplicate keys) are also built on
+split and join: take the root of one treap, split the other treap around its key, recurse on the two left parts and
+on the two right parts, and put the results back together under the root (or join them, if the root's key must not
+be in the result). For treaps of sizes m <= n, this is O(m log(n/m + 1)) work: O(m) when the sizes are similar (as
+for merging sorted arrays), and O(log n) when one of them is tiny. The two recursive calls work on disjoint nodes,
+so the top levels of the recursion run them on separate threads. The operations consume both input treaps: nodes
+that do not end up in the result are freed (without any work in arena mode).
+Compile with -pthread.
+
+---IMPLEMENTED OPERATIONS---
+1. Split and join
+2. Insert and delete (one copy of a key)
+3. Remove or extract a key range, and insert a range back
+4. Search
+5. Find number of elements (size) and height
+6. In-order traversal
+7. Free a treap (O(1) in arena mode)
+8. Union, intersection and difference of two treaps, in parallel
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include "counters.h"
+#include "allocator.h"
+
+// Treap node
+typedef struct node {
+    int data;
+    uint32_t priority;
+    struct node *left;
+    struct node *right;
+} node;
+
+// Allocator for the treap nodes (NULL for malloc()/free()). Set it before the first insert
+allocator *treap_allocator;
+
+// State of the xorshift32 random number generator for priorities
+uint32_t priority_state = 2463534242u;
+
+
+
+// Return a random priority
+uint32_t next_priority() {
+    priority_state ^= priority_state << 13;
+    priority_state ^= priority_state >> 17;
+    priority_state ^= priority_state << 5;
+    return priority_state;
+}
+
+
+// Create a new treap node with data and a random priority
+node* create(int data) {
+    node* new_node = (node*)ds_alloc(treap_allocator, sizeof(node));
+    new_node->data = data;
+    new_node->priority = next_priority();
+    new_node->left = NULL;
+    new_node->right = NULL;
+    return new_node;
+}
+
+
+// Split the treap root into *left (keys < key) and *right (keys >= key)
+void split(node *root, int key, node **left, node **right) {
+    if (root == NULL) {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+    if (root->data < key) {
+        // root and its left subtree go left. Split its right subtree, whose smaller part becomes its new right subtree
+        split(root->right, key, &(root->right), right);
+        *left = root;
+    }
+    else {
+        split(root->left, key, left, &(root->left));
+        *right = root;
+    }
+}
+
+
+// Join the treaps left and right, where every key of left is <= every key of right. Returns the root of the result
+node* join(node *left, node *right) {
+    if (left == NULL) return right;
+    if (right == NULL) return left;
+    // The root with the higher priority stays on top, and the other tree is joined into its inner subtree
+    if (left->priority > right->priority) {
+        left->right = join(left->right, right);
+        return left;
+    }
+    right->left = join(left, right->left);
+    return right;
+}
+
+
+// Insert data into the treap
+void insert(node **root, int data) {
+    node *new_node = create(data);
+    // Walk down while the nodes have a higher priority than the new node, then split the subtree there around data
+    while (*root != NULL && (*root)->priority > new_node->priority) {
+        root = (data < (*root)->data) ? &((*root)->left) : &((*root)->right);
+    }
+    split(*root, data, &(new_node->left), &(new_node->right));
+    *root = new_node;
+}
+
+
+// Delete one copy of data from the treap. Returns false if data is not in it
+bool delete(node **root, int data) {
+    while (*root != NULL && (*root)->data != data) {
+        root = (data < (*root)->data) ? &((*root)->left) : &((*root)->right);
+    }
+    if (*root == NULL) return false;
+    node *del_node = *root;
+    *root = join(del_node->left, del_node->right);
+    ds_free(treap_allocator, del_node, sizeof(node));
+    return true;
+}
+
+
+// Search for data in the treap. Returns true if found
+bool search(node **root, int data) {
+    COUNT(searches);
+    node *temp = *root;
+    while (temp != NULL) {
+        COUNT(nodes_visited);
+        if (data == temp->data) return true;
+        temp = (data < temp->data) ? temp->left : temp->right;
+    }
+    return false;
+}
+
+
+// Free all nodes of a treap. When the nodes come from an allocator without individual frees (an arena), there
+// is nothing to give back per node, so we do not even walk the treap: O(1)
+void free_treap(node **root) {
+    if (treap_allocator != NULL && treap_allocator->free == NULL) {
+        *root = NULL;
+        return;
+    }
+    while (*root != NULL) {
+        free_treap(&((*root)->left));
+        node *right = (*root)->right;
+        ds_free(treap_allocator, *root, sizeof(node));
+        *root = right; // loop instead of recursing on the right subtree
+    }
+}
+
+
+// Cut all keys in [lo, hi] out of the treap and return them as a treap of their own, in O(log n)
+node* extract_range(node **root, int lo, int hi) {
+    if (lo > hi) return NULL;
+    node *below, *rest, *range, *above;
+    split(*root, lo, &below, &rest);
+    if (hi == INT_MAX) {
+        range = rest;
+        above = NULL;
+    }
+    else split(rest, hi + 1, &range, &above);
+    *root = join(below, above);
+    return range;
+}
+
+
+// Remove all keys in [lo, hi] from the treap: O(log n), plus the cost of freeing the removed nodes (none in arena mode)
+void erase_range(node **root, int lo, int hi) {
+    node *range = extract_range(root, lo, hi);
+    free_treap(&range);
+}
+
+
+// Get minimum element in treap
+int get_min(node **root) {
+    if (*root == NULL) {
+        printf("Empty treap, returning -1\n");
+        return -1;
+    }
+    node *temp = *root;
+    while (temp->left != NULL) temp = temp->left;
+    return temp->data;
+}
+
+
+// Get maximum element in treap
+int get_max(node **root) {
+    if (*root == NULL) {
+        printf("Empty treap, returning -1\n");
+        return -1;
+    }
+    node *temp = *root;
+    while (temp->right != NULL) temp = temp->right;
+    return temp->data;
+}
+
+
+// Insert a whole treap (e.g. one returned by extract_range()) into *root, in O(log n). This needs a gap: *root must
+// have no keys strictly between the smallest and the largest key of range. Returns false, leaving both treaps
+// unchanged, if it does not
+bool insert_range(node **root, node *range) {
+    if (range == NULL) return true;
+    int range_min = get_min(&range), range_max = get_max(&range);
+    node *below, *above;
+    split(*root, range_min, &below, &above); // range goes between below and above...
+    if (above != NULL && get_min(&above) < range_max) { // ...which does not work if above starts inside range
+        *root = join(below, above);
+        printf("Cannot insert range [%d, %d]: the treap has keys inside it\n", range_min, range_max);
+        return false;
+    }
+    *root = join(join(below, range), above);
+    return true;
+}
+
+
+// Get number of elements in treap
+int get_size(node **root) {
+    if (*root == NULL) return 0;
+    return 1 + get_size(&((*root)->left)) + get_size(&((*root)->right));
+}
+
+
+// Return maximum of 2 integers
+int max(int x, int y) {
+    return (x>=y)?x:y;
+}
+
+
+// Get height of treap
+int get_height(node **root) {
+    if (*root == NULL) return -1;
+    return 1 + max(get_height(&((*root)->left)), get_height(&((*root)->right)));
+}
+
+
+// In-order traversal (depth-first), printing on one line
+void in_order(node **root) {
+    if (*root == NULL) return;
+    in_order(&((*root)->left));
+    printf(" %d", (*root)->data);
+    in_order(&((*root)->right));
+}
+
+
+// Check that the treap is a BST and a heap on the priorities. Returns true if so
+bool is_treap(node *root, long min_lim, long max_lim) {
+    if (root == NULL) return true;
+    if (root->data < min_lim || root->data > max_lim) return false;
+    if (root->left != NULL && root->left->priority > root->priority) return false;
+    if (root->right != NULL && root->right->priority > root->priority) return false;
+    return is_treap(root->left, min_lim, root->data) && is_treap(root->right, root->data, max_lim);
+}
+
+
+// Set operations computed by set_op()
+typedef enum set_op_kind {
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE // keys of the first treap that are not in the second
+} set_op_kind;
+
+// Arguments and result of a set operation running on its own thread
+typedef struct set_op_args {
+    set_op_kind kind;
+    node *a;
+    node *b;
+    int depth;
+    node *result;
+} set_op_args;
+
+// The recursion levels below this depth run their two recursive calls on two threads
+int set_op_parallel_depth;
+
+
+node* set_op(set_op_kind kind, node *a, node *b, int depth);
+
+void* set_op_thread(void *arg) {
+    set_op_args *args = (set_op_args*)arg;
+    args->result = set_op(args->kind, args->a, args->b, args->depth);
+    return NULL;
+}
+
+
+// Split the treap root into *left (keys < key), *equal (keys == key) and *right (keys > key)
+void split3(node *root, int key, node **left, node **equal, node **right) {
+    node *rest;
+    split(root, key, left, &rest);
+    if (key == INT_MAX) {
+        *equal = rest;
+        *right = NULL;
+    }
+    else split(rest, key + 1, equal, right);
+}
+
+
+// Compute a set operation on the treaps a and b, consuming both. Returns the root of the result
+node* set_op(set_op_kind kind, node *a, node *b, int depth) {
+    if (a == NULL || b == NULL) {
+        if (kind == SET_UNION) return (a != NULL) ? a : b;
+        free_treap(&b); // not in the result of an intersection or difference
+        if (kind == SET_INTERSECTION) free_treap(&a);
+        return a;
+    }
+
+    // The root of the result must have the highest priority of its nodes. The result of a union or intersection
+    // takes nodes from both treaps, so we pick the root with the higher priority. A difference only keeps nodes of a
+    if (kind != SET_DIFFERENCE && b->priority > a->priority) {
+        node *temp = a;
+        a = b;
+        b = temp;
+    }
+    node *b_left, *b_equal, *b_right;
+    split3(b, a->data, &b_left, &b_equal, &b_right);
+    bool in_b = (b_equal != NULL);
+    free_treap(&b_equal); // a's root already has this key
+
+    // Recurse on the left parts and on the right parts, on two threads near the top of the recursion
+    node *result_left, *result_right;
+    set_op_args left_args = {kind, a->left, b_left, depth + 1, NULL};
+    pthread_t thread;
+    if (depth < set_op_parallel_depth && pthread_create(&thread, NULL, set_op_thread, &left_args) == 0) {
+        result_right = set_op(kind, a->right, b_right, depth + 1);
+        pthread_join(thread, NULL);
+        result_left = left_args.result;
+    }
+    else {
+        result_left = set_op(kind, a->left, b_left, depth + 1);
+        result_right = set_op(kind, a->right, b_right, depth + 1);
+    }
+
+    bool keep_root = (kind == SET_UNION) || (kind == SET_INTERSECTION && in_b) || (kind == SET_DIFFERENCE && !in_b);
+    if (keep_root) {
+        a->left = result_left;
+        a->right = result_right;
+        return a;
+    }
+    ds_free(treap_allocator, a, sizeof(node));
+    return join(result_left, result_right);
+}
+
+
+// Return the number of recursion levels to parallelize so that up to threads threads run at once
+int parallel_depth(int threads) {
+    int depth = 0;
+    while ((1 << depth) < threads) depth++;
+    return depth;
+}
+
+
+// Union of the treaps a and b (both consumed), using up to threads threads. treap_allocator must be thread-safe
+// (malloc()) or have no individual frees (arena)
+node* treap_union(node *a, node *b, int threads) {
+    set_op_parallel_depth = parallel_depth(threads);
+    return set_op(SET_UNION, a, b, 0);
+}
+
+
+// Intersection of the treaps a and b (both consumed), using up to threads threads
+node* treap_intersection(node *a, node *b, int threads) {
+    set_op_parallel_depth = parallel_depth(threads);
+    return set_op(SET_INTERSECTION, a, b, 0);
+}
+
+
+// Difference a - b of the treaps a and b (both consumed), using up to threads threads
+node* treap_difference(node *a, node *b, int threads) {
+    set_op_parallel_depth = parallel_depth(threads);
+    return set_op(SET_DIFFERENCE, a, b, 0);
+}
+
+
+// Union the old way: walk b in order and insert each of its keys that is not in a yet
+void insert_each(node **a, node **b) {
+    if (*b == NULL) return;
+    insert_each(a, &((*b)->left));
+    if (!search(a, (*b)->data)) insert(a, (*b)->data);
+    insert_each(a, &((*b)->right));
+}
+
+
+// Build a treap of the keys first, first + step, ... (n keys)
+node* build_sequence(int first, int step, int n) {
+    node *root = NULL;
+    for (int i = 0; i < n; i++) insert(&root, first + i * step);
+    return root;
+}
+
+
+// Wall-clock time in seconds (clock() would add up the CPU time of all threads)
+double wall_time() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Benchmark: union, intersection and difference of the multiples of 2 and the multiples of 3 (n keys each), on
+// 1, 2, 4 and 8 threads, and the union by inserting each key of one treap into the other
+void compare_set_ops(int n) {
+    const char *names[] = {"union", "intersection", "difference"};
+    printf("\nSet operations on 2 treaps of %d keys (multiples of 2 and of 3)\n", n);
+    for (int kind = SET_UNION; kind <= SET_DIFFERENCE; kind++) {
+        for (int threads = 1; threads <= 8; threads *= 2) {
+            node *a = build_sequence(0, 2, n);
+            node *b = build_sequence(0, 3, n);
+            double start = wall_time();
+            node *result;
+            if (kind == SET_UNION) result = treap_union(a, b, threads);
+            else if (kind == SET_INTERSECTION) result = treap_intersection(a, b, threads);
+            else result = treap_difference(a, b, threads);
+            double secs = wall_time() - start;
+            printf("%-12s %d thread(s): %.4f s, result has %d keys, is treap: %d\n", names[kind], threads, secs,
+                   get_size(&result), is_treap(result, INT_MIN, INT_MAX));
+            free_treap(&result);
+        }
+    }
+
+    node *a = build_sequence(0, 2, n);
+    node *b = build_sequence(0, 3, n);
+    double start = wall_time();
+    insert_each(&a, &b);
+    printf("union by inserting each key: %.4f s, result has %d keys\n", wall_time() - start, get_size(&a));
+    free_treap(&a);
+    free_treap(&b);
+}
+
+
+// Benchmark: expire the oldest quarter of n timestamps (all keys below a cutoff), one delete per key vs one
+// erase_range(), with the nodes allocated by malloc() and from an arena
+void compare_range_erase(int n) {
+    allocator *saved_allocator = treap_allocator;
+    arena_allocator arena;
+    arena_init(&arena, 0);
+    allocator *allocators[] = {NULL, &arena.base};
+    const char *allocator_names[] = {"malloc", "arena"};
+    int cutoff = n / 4;
+
+    printf("\nExpiring %d of %d timestamps\n", cutoff, n);
+    for (int a = 0; a < 2; a++) {
+        treap_allocator = allocators[a];
+        for (int method = 0; method < 2; method++) {
+            node *root = NULL;
+            for (int i = 0; i < n; i++) insert(&root, i); // timestamps arrive in increasing order
+            clock_t start = clock();
+            if (method == 0) {
+                for (int i = 0; i < cutoff; i++) delete(&root, i);
+            }
+            else erase_range(&root, INT_MIN, cutoff - 1);
+            double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+            printf("%-6s %-15s %.6f s, %d left, smallest %d, height %d\n", allocator_names[a],
+                   method == 0 ? "delete() x n/4:" : "erase_range():", secs, get_size(&root), get_min(&root), get_height(&root));
+            free_treap(&root);
+            if (a == 1) arena_reset(&arena);
+        }
+    }
+    arena_release(&arena);
+    treap_allocator = saved_allocator;
+}
+
+
+
+int main() {
+    node *root = NULL; // Empty treap
+    int n, x;
+
+    printf("Enter the number of elements to insert: ");
+    scanf("%d", &n);
+    for (int i=0; i<n; i++) {
+        printf("Enter number to insert: ");
+        scanf("%d", &x);
+        insert(&root, x);
+    }
+
+    // Sorted inserts would make a plain BST a linked list. Here the height stays logarithmic
+    for (int i = 1; i <= 1000; i++) insert(&root, 1000 + i);
+    printf("\nSize: %d, height: %d, is treap: %d\n", get_size(&root), get_height(&root), is_treap(root, INT_MIN, INT_MAX));
+
+    // Move a key range out and back in
+    node *range = extract_range(&root, 1101, 1900);
+    printf("Extracted %d keys in [1101, 1900], %d left. Is 1500 still in the treap? %d\n", get_size(&range), get_size(&root), search(&root, 1500));
+    insert_range(&root, range);
+    printf("Inserted them back: size %d, is treap: %d, is 1500 in it? %d\n", get_size(&root), is_treap(root, INT_MIN, INT_MAX), search(&root, 1500));
+
+    // Drop everything above 1000
+    erase_range(&root, 1001, INT_MAX);
+    printf("After erasing [1001, INT_MAX]:");
+    in_order(&root);
+    printf("\n");
+
+    free_treap(&root);
+    compare_range_erase(1 << 20);
+    compare_set_ops(1 << 18);
+    counters_print();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,401 @@
+/*
+Unrolled Linked List
+
+A linked list in which every node (called a block here) holds a small array of elements plus a count,
+instead of a single element. Compared to linked_list.c:
+- a traversal takes one cache miss per block instead of one per int
+- there is one malloc() per block instead of one per int, and no per-element next ptr
+- searching inside a block is a scan over a contiguous array, which we do with SIMD compares
+  (AVX2: 8 ints per instruction, SSE2: 4 ints per instruction, plain C loop otherwise)
+
+A block is sized to exactly 2 cache lines (128 bytes): BLOCK_CAPACITY ints, the count, and the next ptr.
+Blocks are allocated on a cache line boundary, so a block never straddles more lines than it needs.
+
+To keep blocks reasonably full, inserting into a full block splits it into two half-full blocks, and
+deleting from a block that becomes less than half full either merges it with the next block (if all
+elements fit into one block) or borrows elements from the next block.
+
+Positions are 1-based, as in linked_list.c. Like linked_list.c, the functions below work on a global head ptr. Like the
+dll handle in doubly_linked_list.c, they also keep a tail ptr and the number of elements, so that appending and getting
+the length are O(1) instead of a walk over all blocks.
+
+search_data() returns the block holding the match and the index of the match within the block, instead of a node ptr,
+because elements do not have nodes of their own.
+
+Build with -mavx2 (or -march=native) to get the AVX2 search, SSE2 is always available on x86-64.
+
+---IMPLEMENTED OPERATIONS---
+
+1. Insert element:
+- at the beginning
+- at the end
+- at nth position
+
+2. Delete element:
+- at the beginning
+- at the end
+- at nth position
+
+3. Search element (SIMD linear search within each block)
+
+4. Print the entire linked list data
+
+5. Get length of a linked list (number of elements) and number of blocks
+
+6. Free all blocks
+
+7. Allocate the blocks from a pluggable allocator (ull_allocator), e.g. a tracking allocator that reports the memory
+used by the list (see "allocator.h")
+
+8. Compare search speed and memory (allocations, bytes per element) against a plain linked list (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define BLOCK_BYTES 128 // 2 cache lines
+#define BLOCK_CAPACITY ((BLOCK_BYTES - sizeof(int) - sizeof(void*)) / sizeof(int)) // 29 ints on 64-bit
+
+// Unrolled Linked List block
+typedef struct block {
+    int data[BLOCK_CAPACITY];
+    int count; // number of elements in use, data[0..count-1]
+    struct block *next;
+} block;
+
+// Global variables that point to the first and the last block, and the number of elements in all blocks
+block *head;
+block *tail;
+int length;
+
+// Allocator for the blocks (NULL for aligned_alloc()/free()). Set it before the first insert
+allocator *ull_allocator;
+
+
+
+// Allocate a new empty block, aligned to a cache line
+block* new_block() {
+    block *b = (block*)ds_alloc_aligned(ull_allocator, 64, sizeof(block));
+    b->count = 0;
+    b->next = NULL;
+    return b;
+}
+
+
+// Return index of the first element equal to x in block b, or -1 if there is none
+int block_find(block *b, int x) {
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi32(x);
+    for (; i + 8 <= b->count; i += 8) {
+        __m256i v = _mm256_loadu_si256((__m256i*)(b->data + i));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, key)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    __m128i key = _mm_set1_epi32(x);
+    for (; i + 4 <= b->count; i += 4) {
+        __m128i v = _mm_loadu_si128((__m128i*)(b->data + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, key)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < b->count; i++) { // leftover elements (or everything, without SIMD)
+        if (b->data[i] == x) return i;
+    }
+    return -1;
+}
+
+
+// Print full LL
+void printLL() {
+    if (head == NULL) {
+        printf("Linked List is empty!\n");
+        return;
+    }
+    printf("\n--Start LL--\n");
+    for (block *b = head; b != NULL; b = b->next) {
+        for (int i = 0; i < b->count; i++) printf("Data: %d\n", b->data[i]);
+    }
+    printf("--End LL--\n\n");
+}
+
+
+// Get number of elements in LL
+int get_length() {
+    return length;
+}
+
+
+// Get number of blocks in LL
+int get_blocks() {
+    int blocks = 0;
+    for (block *b = head; b != NULL; b = b->next) blocks++;
+    return blocks;
+}
+
+
+// Insert element x at nth position (1 <= n <= length+1)
+void insert_node(int n, int x) {
+    if (n < 1) {
+        printf("Invalid position %d\n", n);
+        return;
+    }
+    if (head == NULL) {
+        if (n > 1) {
+            printf("LL is empty. You are trying to insert a node at a position n>1. Please choose n=1\n");
+            return;
+        }
+        head = new_block();
+        tail = head;
+    }
+
+    // Find the block and the index within it where x goes
+    block *b = head;
+    int pos = n - 1;
+    COUNT(searches);
+    COUNT(nodes_visited); // b itself, whose count and data are read below
+    while (pos > b->count && b->next != NULL) {
+        COUNT(nodes_visited);
+        pos -= b->count;
+        b = b->next;
+    }
+    if (pos > b->count) {
+        printf("LL too small for a node to be added at %dth position\n", n);
+        return;
+    }
+
+    // Full block: split it, moving its upper half into a new block right after it
+    if (b->count == (int)BLOCK_CAPACITY) {
+        block *second = new_block();
+        int half = b->count / 2;
+        second->count = b->count - half;
+        memcpy(second->data, b->data + half, sizeof(int) * second->count);
+        b->count = half;
+        second->next = b->next;
+        b->next = second;
+        if (tail == b) tail = second;
+        if (pos > half) {
+            pos -= half;
+            b = second;
+        }
+    }
+
+    memmove(b->data + pos + 1, b->data + pos, sizeof(int) * (b->count - pos));
+    b->data[pos] = x;
+    b->count++;
+    length++;
+}
+
+
+// Delete element at nth position (1 <= n <= length)
+void delete_node(int n) {
+    if (head == NULL) {
+        printf("Linked List is empty!\n");
+        return;
+    }
+
+    block *prev = NULL;
+    block *b = head;
+    int pos = n - 1;
+    COUNT(searches);
+    while (b != NULL) {
+        COUNT(nodes_visited);
+        if (pos < b->count) break;
+        pos -= b->count;
+        prev = b;
+        b = b->next;
+    }
+    if (n < 1 || b == NULL) {
+        printf("Cannot delete node at position %d for a LL of length %d\n", n, get_length());
+        return;
+    }
+
+    memmove(b->data + pos, b->data + pos + 1, sizeof(int) * (b->count - pos - 1));
+    b->count--;
+    length--;
+
+    block *next = b->next;
+    if (next != NULL && b->count + next->count <= (int)BLOCK_CAPACITY) {
+        // Merge the next block into this one
+        memcpy(b->data + b->count, next->data, sizeof(int) * next->count);
+        b->count += next->count;
+        b->next = next->next;
+        if (tail == next) tail = b;
+        ds_free_aligned(ull_allocator, next, 64, sizeof(block));
+    }
+    else if (next != NULL && b->count < (int)BLOCK_CAPACITY / 2) {
+        // Borrow elements from the front of the next block, so that both end up about equally full
+        int moved = (next->count - b->count) / 2;
+        memcpy(b->data + b->count, next->data, sizeof(int) * moved);
+        memmove(next->data, next->data + moved, sizeof(int) * (next->count - moved));
+        b->count += moved;
+        next->count -= moved;
+    }
+    else if (b->count == 0) {
+        // Last block became empty
+        if (prev == NULL) head = NULL;
+        else prev->next = NULL;
+        tail = prev;
+        ds_free_aligned(ull_allocator, b, 64, sizeof(block));
+    }
+}
+
+
+// Insert element at beginning of LL
+void insert_beg(int x) {
+    insert_node(1, x);
+}
+
+
+// Insert element at end of LL in O(1), through the tail ptr. A full tail block is not split: a new block is started
+// after it, so that a list built by appending has full blocks
+void insert_end(int x) {
+    if (tail == NULL || tail->count == (int)BLOCK_CAPACITY) {
+        block *b = new_block();
+        if (tail == NULL) head = b;
+        else tail->next = b;
+        tail = b;
+    }
+    tail->data[tail->count++] = x;
+    length++;
+}
+
+
+// Delete element at beginning of LL
+void delete_beg() {
+    delete_node(1);
+}
+
+
+// Delete element at end of LL
+void delete_end() {
+    delete_node(get_length());
+}
+
+
+// Search LL for data. Returns ptr to the block holding the first match and sets *index to the match's index
+// within that block. Returns NULL if data is not found
+block* search_data(int data, int *index) {
+    COUNT(searches);
+    for (block *b = head; b != NULL; b = b->next) {
+        COUNT(nodes_visited);
+        int i = block_find(b, data);
+        if (i >= 0) {
+            if (index != NULL) *index = i;
+            return b;
+        }
+    }
+    return NULL;
+}
+
+
+// Free all blocks
+void free_list() {
+    while (head != NULL) {
+        block *next = head->next;
+        ds_free_aligned(ull_allocator, head, 64, sizeof(block));
+        head = next;
+    }
+    tail = NULL;
+    length = 0;
+}
+
+
+
+// Plain linked list node, as in linked_list.c. Only used for the comparison in main()
+typedef struct node {
+    int data;
+    struct node *next;
+} node;
+
+
+// Build a plain LL and an unrolled LL with the same n elements, then time searches for a missing value
+// (a full scan of both lists)
+void compare_with_LL(int n, int searches) {
+    allocator *saved_allocator = ull_allocator;
+    tracking_allocator ll_tracker, unrolled_tracker;
+    tracking_init(&ll_tracker, NULL);
+    tracking_init(&unrolled_tracker, NULL);
+    ull_allocator = &unrolled_tracker.base;
+    node *ll_head = NULL;
+    for (int i = n - 1; i >= 0; i--) {
+        node *new_node = (node*)ds_alloc(&ll_tracker.base, sizeof(node));
+        new_node->data = i;
+        new_node->next = ll_head;
+        ll_head = new_node;
+    }
+
+    for (int i = 0; i < n; i++) insert_end(i);
+
+    int found = 0;
+    clock_t start = clock();
+    for (int s = 0; s < searches; s++) {
+        node *temp = ll_head;
+        while (temp != NULL && temp->data != -1 - s) temp = temp->next;
+        found += (temp != NULL);
+    }
+    double ll_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int s = 0; s < searches; s++) found += (search_data(-1 - s, NULL) != NULL);
+    double unrolled_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    tracking_report(&ll_tracker, "LL", n);
+    tracking_report(&unrolled_tracker, "Unrolled LL", n);
+    printf("Search (full scan) time: LL %.3fs, unrolled LL %.3fs (%d found)\n", ll_secs, unrolled_secs, found);
+
+    free_list();
+    while (ll_head != NULL) {
+        node *next = ll_head->next;
+        ds_free(&ll_tracker.base, ll_head, sizeof(node));
+        ll_head = next;
+    }
+    ull_allocator = saved_allocator;
+}
+
+
+
+int main() {
+    // Allocate the blocks through a tracking allocator, to see how much memory the list uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    ull_allocator = &tracker.base;
+    head = NULL;
+    tail = NULL;
+    length = 0;
+    int data_elements;
+    int x;
+    printf("Enter number of elements to add to LL: ");
+    scanf("%d", &data_elements);
+    for (int i=0; i<data_elements; i++) {
+        printf("Enter number to add to end of LL: ");
+        scanf("%d", &x);
+        insert_end(x);
+    }
+
+    insert_node(2, 99);
+    printLL();
+    delete_end();
+    delete_beg();
+    printLL();
+
+    int index;
+    block *b = search_data(99, &index);
+    if (b != NULL) printf("Found 99 at index %d of its block\n", index);
+    printf("LL has %d elements in %d blocks (%zu bytes per block)\n", get_length(), get_blocks(), sizeof(block));
+    tracking_report(&tracker, "Unrolled LL", get_length());
+    counters_print();
+    free_list();
+
+    compare_with_LL(1000000, 50);
+
+    return EXIT_SUCCESS;
+}
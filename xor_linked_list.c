@@ -0,0 +1,338 @@
+/*
+XOR Linked List
+
+A memory-compact variant of the doubly linked list. Instead of storing separate prev and next ptrs,
+each node stores a single link field equal to (address of prev node) XOR (address of next node).
+NULL (address 0) is used for the missing neighbour of the first and last nodes.
+
+Since a ^ b ^ a = b, if we know the address of one neighbour of a node, we can recover the other one:
+    next = link ^ prev
+    prev = link ^ next
+So we can still traverse the list in both directions, as long as we start from one of its ends and carry the
+address of the previous node along with us. What we lose is the ability to go from a single node ptr to its
+neighbours (e.g. the ptr returned by search_data() is not enough to unlink that node in O(1)).
+
+On a 64-bit machine, a DLL node is 24 bytes (4-byte int + 4 bytes of padding + two 8-byte ptrs), while an
+XOR list node is 16 bytes (4-byte int + 4 bytes of padding + one 8-byte link), a third less per element.
+
+Reversing an XOR list is O(1): the link of every node is symmetric in prev and next, so a list read from the
+tail is exactly the reversed list. We only need to swap the head and tail ptrs.
+
+---IMPLEMENTED OPERATIONS---
+
+1. Insert node:
+- at the beginning
+- at the end
+
+2. Delete node:
+- at the beginning
+- at the end
+
+3. Search node (linear search)
+
+4. Print the entire list data
+- iteratively
+- iteratively, in reverse order
+
+5. Get length of the list (cached in the list handle)
+
+6. Reverse the list in O(1)
+
+7. Free all nodes
+
+8. Allocate the nodes from a pluggable allocator (xll_allocator), e.g. a tracking allocator that reports the memory used by the list (see "allocator.h")
+
+9. Compare bytes per element and traversal throughput against the DLL (see main())
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "counters.h"
+#include "allocator.h"
+
+// XOR Linked List node
+typedef struct node {
+    int data;
+    uintptr_t link; // address of prev node XOR address of next node
+} node;
+
+// List handle. We need ptrs to both ends, because traversal can only start from an end
+typedef struct xll {
+    node *head;
+    node *tail;
+    int length;
+} xll;
+
+// Allocator for the nodes (NULL for malloc()/free()). Set it before the first insert
+allocator *xll_allocator;
+
+
+// Return the neighbour of cur that is not other
+node* xor_step(node *cur, node *other) {
+    return (node*)(cur->link ^ (uintptr_t)other);
+}
+
+
+// Initialize an empty list
+void xll_init(xll *list) {
+    list->head = NULL;
+    list->tail = NULL;
+    list->length = 0;
+}
+
+
+// Insert node at the beginning
+void insert_beg(xll *list, int x) {
+    node *new_node = (node*)ds_alloc(xll_allocator, sizeof(node));
+    new_node->data = x;
+    new_node->link = (uintptr_t)list->head; // prev is NULL, so link = NULL ^ head = head
+
+    if (list->head == NULL) list->tail = new_node;
+    else list->head->link ^= (uintptr_t)new_node; // old head's prev changes from NULL to new_node
+
+    list->head = new_node;
+    list->length++;
+}
+
+
+// Insert node at the end
+void insert_end(xll *list, int x) {
+    node *new_node = (node*)ds_alloc(xll_allocator, sizeof(node));
+    new_node->data = x;
+    new_node->link = (uintptr_t)list->tail; // next is NULL, so link = tail ^ NULL = tail
+
+    if (list->tail == NULL) list->head = new_node;
+    else list->tail->link ^= (uintptr_t)new_node; // old tail's next changes from NULL to new_node
+
+    list->tail = new_node;
+    list->length++;
+}
+
+
+// Delete node at the beginning
+void del_beg(xll *list) {
+    if (list->head == NULL) {
+        printf("XOR list is empty! Nothing to delete\n");
+        return;
+    }
+
+    node *first = list->head;
+    node *second = xor_step(first, NULL);
+    if (second == NULL) list->tail = NULL;
+    else second->link ^= (uintptr_t)first; // second's prev changes from first to NULL
+
+    list->head = second;
+    ds_free(xll_allocator, first, sizeof(node));
+    list->length--;
+}
+
+
+// Delete node at the end
+void del_end(xll *list) {
+    if (list->tail == NULL) {
+        printf("XOR list is empty! Nothing to delete\n");
+        return;
+    }
+
+    node *last = list->tail;
+    node *second_last = xor_step(last, NULL);
+    if (second_last == NULL) list->head = NULL;
+    else second_last->link ^= (uintptr_t)last; // second last's next changes from last to NULL
+
+    list->tail = second_last;
+    ds_free(xll_allocator, last, sizeof(node));
+    list->length--;
+}
+
+
+// Reverse the list in O(1)
+void reverse(xll *list) {
+    node *temp = list->head;
+    list->head = list->tail;
+    list->tail = temp;
+}
+
+
+// Get length of the list, that is, number of nodes
+int get_length(xll *list) {
+    return list->length;
+}
+
+
+// Linear search. Returns ptr to the first node holding num, or NULL if not found
+node* search_data(xll *list, int num) {
+    node *prev = NULL;
+    node *cur = list->head;
+    COUNT(searches);
+    while (cur != NULL) {
+        COUNT(nodes_visited);
+        if (cur->data == num) return cur;
+        node *next = xor_step(cur, prev);
+        prev = cur;
+        cur = next;
+    }
+    return NULL;
+}
+
+
+// Print the list, walking from start to the other end
+void print_from(node *start) {
+    node *prev = NULL;
+    node *cur = start;
+    while (cur != NULL) {
+        printf("Data: %d\n", cur->data);
+        node *next = xor_step(cur, prev);
+        prev = cur;
+        cur = next;
+    }
+}
+
+
+// Print the list
+void printLL(xll *list) {
+    if (list->head == NULL) {
+        printf("XOR list is empty!\n");
+        return;
+    }
+    printf("\n--Start LL--\n");
+    print_from(list->head);
+    printf("--End LL--\n\n");
+}
+
+
+// Print the list in reverse order
+void reverse_printLL(xll *list) {
+    if (list->tail == NULL) {
+        printf("XOR list is empty!\n");
+        return;
+    }
+    printf("\n--Start LL in reverse order--\n");
+    print_from(list->tail);
+    printf("--End LL--\n\n");
+}
+
+
+// Free all nodes
+void free_list(xll *list) {
+    while (list->head != NULL) del_beg(list);
+}
+
+
+
+// Doubly Linked List node, as in doubly_linked_list.c. Only used for the comparison in main()
+typedef struct dll_node {
+    int data;
+    struct dll_node *next;
+    struct dll_node *prev;
+} dll_node;
+
+
+// Sum all data in the XOR list by walking it from head to tail
+long long xll_sum(xll *list) {
+    long long sum = 0;
+    node *prev = NULL;
+    node *cur = list->head;
+    while (cur != NULL) {
+        sum += cur->data;
+        node *next = xor_step(cur, prev);
+        prev = cur;
+        cur = next;
+    }
+    return sum;
+}
+
+
+// Sum all data in a DLL by walking it from head to tail
+long long dll_sum(dll_node *head) {
+    long long sum = 0;
+    for (dll_node *cur = head; cur != NULL; cur = cur->next) sum += cur->data;
+    return sum;
+}
+
+
+// Build an XOR list and a DLL with the same n elements and compare memory and traversal speed.
+// Note that malloc rounds small requests up to its own minimum chunk size (32 bytes on 64-bit glibc, including its
+// header), so the per-element saving only shows up fully when nodes are carved from a pool or an arena.
+void compare_with_dll(int n, int rounds) {
+    allocator *saved_allocator = xll_allocator;
+    tracking_allocator xll_tracker, dll_tracker;
+    tracking_init(&xll_tracker, NULL);
+    tracking_init(&dll_tracker, NULL);
+    xll_allocator = &xll_tracker.base;
+    xll list;
+    xll_init(&list);
+    dll_node *dll_head = NULL, *dll_tail = NULL;
+    for (int i = 0; i < n; i++) {
+        insert_end(&list, i);
+
+        dll_node *new_node = (dll_node*)ds_alloc(&dll_tracker.base, sizeof(dll_node));
+        new_node->data = i;
+        new_node->next = NULL;
+        new_node->prev = dll_tail;
+        if (dll_tail == NULL) dll_head = new_node;
+        else dll_tail->next = new_node;
+        dll_tail = new_node;
+    }
+
+    long long check = 0;
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++) check += xll_sum(&list);
+    double xll_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < rounds; r++) check -= dll_sum(dll_head);
+    double dll_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    double elements = (double)n * rounds;
+    tracking_report(&xll_tracker, "XOR list", n);
+    tracking_report(&dll_tracker, "DLL", n);
+    printf("Traversal throughput (M elements/s): XOR list %.1f, DLL %.1f (checksum difference %lld)\n",
+           xll_secs > 0 ? elements / xll_secs / 1e6 : 0.0, dll_secs > 0 ? elements / dll_secs / 1e6 : 0.0, check);
+
+    free_list(&list);
+    while (dll_head != NULL) {
+        dll_node *next = dll_head->next;
+        ds_free(&dll_tracker.base, dll_head, sizeof(dll_node));
+        dll_head = next;
+    }
+    xll_allocator = saved_allocator;
+}
+
+
+
+int main() {
+    // Allocate the nodes through a tracking allocator, to see how much memory the list uses
+    tracking_allocator tracker;
+    tracking_init(&tracker, NULL);
+    xll_allocator = &tracker.base;
+    xll list;
+    xll_init(&list);
+    int num_elements, x;
+
+    printf("Enter the number of elements to add to XOR list: ");
+    scanf("%d", &num_elements);
+    for (int i=0; i<num_elements; i++) {
+        printf("Enter number to add: ");
+        scanf("%d", &x);
+        insert_end(&list, x);
+    }
+
+    insert_beg(&list, 99);
+    printLL(&list);
+    reverse(&list);
+    printf("After O(1) reverse:");
+    printLL(&list);
+    del_beg(&list);
+    del_end(&list);
+    reverse_printLL(&list);
+    printf("XOR list has %d nodes\n", get_length(&list));
+    tracking_report(&tracker, "XOR list", get_length(&list));
+    counters_print();
+    free_list(&list);
+
+    compare_with_dll(1000000, 20);
+
+    return EXIT_SUCCESS;
+}
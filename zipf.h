@@ -0,0 +1,55 @@
+// This header file contains a small random number generator and a Zipf distribution sampler, defined here so that
+// other .c source files can include it. cache.c and binary_search_tree.c use them to build skewed workloads, in which
+// a few hot keys get most of the accesses, as in real caches and search indexes.
+//
+// In a Zipf distribution with skew s over n ranks, rank k (counting from 0) is drawn with probability proportional
+// to 1/(k+1)^s. zipf_cdf() computes the cumulative distribution function once, in O(n), and next_zipf() then draws a
+// rank with a binary search for the first rank whose cdf reaches a uniform random number, in O(log n).
+//
+// Source files that include this header must be compiled with -lm (zipf_cdf() uses pow()).
+
+
+#ifndef ZIPF_H
+#define ZIPF_H
+
+#include <stdlib.h>
+#include <math.h>
+
+
+
+// xorshift64 random number generator, returns a double in [0, 1). state must not be 0
+double next_uniform(unsigned long long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// Return the cumulative distribution function of a Zipf distribution with the given skew over n ranks, in a
+// malloc()ed array of n doubles that the caller frees
+double* zipf_cdf(int n, double skew) {
+    double *cdf = (double*)malloc(sizeof(double) * n);
+    double total = 0, running = 0;
+    for (int k = 0; k < n; k++) total += 1.0 / pow(k + 1, skew);
+    for (int k = 0; k < n; k++) {
+        running += 1.0 / pow(k + 1, skew) / total;
+        cdf[k] = running;
+    }
+    return cdf;
+}
+
+
+// Draw a rank in [0, n) from a Zipf distribution, given its cumulative distribution function
+int next_zipf(double *cdf, int n, unsigned long long *state) {
+    double u = next_uniform(state);
+    int lo = 0, hi = n - 1;
+    while (lo < hi) { // binary search for the first rank with cdf >= u
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] < u) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+#endif